@@ -14,10 +14,26 @@
 
 #include "CoreBase.h"
 #include "RandomNumberGenerator.h"
+#include "Volume/EncryptionThreadPool.h"
 #include "Volume/Volume.h"
 
 namespace VeraCrypt
 {
+	namespace
+	{
+		// Header wipe pass whose key is derived ahead of the header write
+		struct HeaderPass
+		{
+			HeaderPass (bool backupHeader, size_t saltSize)
+				: BackupHeader (backupHeader), HeaderKey (VolumeHeader::GetLargestSerializedKeySize()), Salt (saltSize) { }
+
+			bool BackupHeader;
+			SecureBuffer HeaderKey;
+			EncryptionThreadPool::PendingKeyDerivation KeyDerivation;
+			SecureBuffer Salt;
+		};
+	}
+
 	CoreBase::CoreBase ()
 		: DeviceChangeInProgress (false)
 	{
@@ -52,25 +68,23 @@ namespace VeraCrypt
 
 		RandomNumberGenerator::SetHash (newPkcs5Kdf->GetHash());
 
-		SecureBuffer newSalt (openVolume->GetSaltSize());
-		SecureBuffer newHeaderKey (VolumeHeader::GetLargestSerializedKeySize());
-
 		shared_ptr <VolumePassword> password (Keyfile::ApplyListToPassword (newKeyfiles, newPassword));
 
+		vector < shared_ptr <HeaderPass> > passes;
+
 		bool backupHeader = false;
 		while (true)
 		{
 			for (int i = 1; i <= wipeCount; i++)
 			{
+				shared_ptr <HeaderPass> pass (new HeaderPass (backupHeader, openVolume->GetSaltSize()));
+
 				if (i == wipeCount)
-					RandomNumberGenerator::GetData (newSalt);
+					RandomNumberGenerator::GetData (pass->Salt);
 				else
-					RandomNumberGenerator::GetDataFast (newSalt);
+					RandomNumberGenerator::GetDataFast (pass->Salt);
 
-				newPkcs5Kdf->DeriveKey (newHeaderKey, *password, newPim, newSalt);
-
-				openVolume->ReEncryptHeader (backupHeader, newSalt, newHeaderKey, newPkcs5Kdf);
-				openVolume->GetFile()->Flush();
+				passes.push_back (pass);
 			}
 
 			if (!openVolume->GetLayout()->HasBackupHeader() || backupHeader)
@@ -78,6 +92,45 @@ namespace VeraCrypt
 
 			backupHeader = true;
 		}
+
+		// Header keys of the following passes of both headers are derived on the thread pool while a pass is written
+		size_t maxPendingPasses = EncryptionThreadPool::GetThreadCount();
+		if (maxPendingPasses < 1)
+			maxPendingPasses = 1;
+
+		size_t nextPass = 0;
+
+		try
+		{
+			for (size_t i = 0; i < passes.size(); ++i)
+			{
+				while (nextPass < passes.size() && nextPass < i + maxPendingPasses)
+				{
+					HeaderPass &pass = *passes[nextPass++];
+					EncryptionThreadPool::BeginKeyDerivation (pass.KeyDerivation, *newPkcs5Kdf, *password, newPim, pass.Salt, pass.HeaderKey);
+				}
+
+				HeaderPass &pass = *passes[i];
+				EncryptionThreadPool::EndKeyDerivation (pass.KeyDerivation);
+
+				openVolume->ReEncryptHeader (pass.BackupHeader, pass.Salt, pass.HeaderKey, newPkcs5Kdf);
+				openVolume->GetFile()->Flush();
+			}
+		}
+		catch (...)
+		{
+			// Derivations still in progress must not outlive their buffers
+			for (size_t i = 0; i < nextPass; ++i)
+			{
+				try
+				{
+					EncryptionThreadPool::EndKeyDerivation (passes[i]->KeyDerivation);
+				}
+				catch (...) { }
+			}
+
+			throw;
+		}
 	}
 
 	void CoreBase::ChangePassword (shared_ptr <VolumePath> volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, shared_ptr <VolumePassword> newPassword, int newPim, shared_ptr <KeyfileList> newKeyfiles, shared_ptr <Pkcs5Kdf> newPkcs5Kdf, int wipeCount) const
@@ -254,10 +307,10 @@ namespace VeraCrypt
 		return GetMountedVolume (volumePath);
 	}
 
-	shared_ptr <Volume> CoreBase::OpenVolume (shared_ptr <VolumePath> volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, int pim, shared_ptr<Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, int protectionPim, shared_ptr<Pkcs5Kdf> protectionKdf, shared_ptr <KeyfileList> protectionKeyfiles, bool sharedAccessAllowed, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope) const
+	shared_ptr <Volume> CoreBase::OpenVolume (shared_ptr <VolumePath> volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, int pim, shared_ptr<Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, int protectionPim, shared_ptr<Pkcs5Kdf> protectionKdf, shared_ptr <KeyfileList> protectionKeyfiles, bool sharedAccessAllowed, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope, const VolumeOpenHint &hint) const
 	{
 		make_shared_auto (Volume, volume);
-		volume->Open (*volumePath, preserveTimestamps, password, pim, kdf, truecryptMode, keyfiles, protection, protectionPassword, protectionPim, protectionKdf, protectionKeyfiles, sharedAccessAllowed, volumeType, useBackupHeaders, partitionInSystemEncryptionScope);
+		volume->Open (*volumePath, preserveTimestamps, password, pim, kdf, truecryptMode, keyfiles, protection, protectionPassword, protectionPim, protectionKdf, protectionKeyfiles, sharedAccessAllowed, volumeType, useBackupHeaders, partitionInSystemEncryptionScope, hint);
 		return volume;
 	}
 
@@ -21,9 +21,18 @@ namespace VeraCrypt
 #define TC_CLONE(NAME) NAME = other.NAME
 #define TC_CLONE_SHARED(TYPE,NAME) NAME = other.NAME ? make_shared <TYPE> (*other.NAME) : shared_ptr <TYPE> ()
 
+		TC_CLONE (AllowDiscards);
 		TC_CLONE (CachePassword);
+		TC_CLONE (CachedPasswords);
+		TC_CLONE (DirectIo);
 		TC_CLONE (FilesystemOptions);
 		TC_CLONE (FilesystemType);
+		TC_CLONE (HeaderKeyCacheTimeout);
+		TC_CLONE (Hint);
+		TC_CLONE (KernelCryptoNoReadWorkqueue);
+		TC_CLONE (KernelCryptoNoWriteWorkqueue);
+		TC_CLONE (KernelCryptoSameCpu);
+		TC_CLONE (KernelCryptoSubmitFromCryptCpus);
 		TC_CLONE_SHARED (KeyfileList, Keyfiles);
 		TC_CLONE_SHARED (DirectoryPath, MountPoint);
 		TC_CLONE (NoFilesystem);
@@ -48,11 +57,14 @@ namespace VeraCrypt
 		else
 			ProtectionKdf.reset();
 		TC_CLONE_SHARED (KeyfileList, ProtectionKeyfiles);
+		TC_CLONE (ReadAheadSize);
 		TC_CLONE (Removable);
+		TC_CLONE (SectorCacheSize);
 		TC_CLONE (SharedAccessAllowed);
 		TC_CLONE (SlotNumber);
 		TC_CLONE (UseBackupHeaders);
 		TC_CLONE (TrueCryptMode);
+		TC_CLONE (WriteBackSize);
 	}
 
 	void MountOptions::Deserialize (shared_ptr <Stream> stream)
@@ -125,6 +137,25 @@ namespace VeraCrypt
 
 		sr.Deserialize ("Pim", Pim);
 		sr.Deserialize ("ProtectionPim", ProtectionPim);
+
+		sr.Deserialize ("HintEncryptionAlgorithmName", Hint.EncryptionAlgorithmName);
+		sr.Deserialize ("HintKdfName", Hint.KdfName);
+		Hint.Type = static_cast <VolumeType::Enum> (sr.DeserializeInt32 ("HintType"));
+
+		sr.Deserialize ("HeaderKeyCacheTimeout", HeaderKeyCacheTimeout);
+		sr.Deserialize ("ReadAheadSize", ReadAheadSize);
+		sr.Deserialize ("SectorCacheSize", SectorCacheSize);
+		sr.Deserialize ("WriteBackSize", WriteBackSize);
+		sr.Deserialize ("DirectIo", DirectIo);
+		sr.Deserialize ("AllowDiscards", AllowDiscards);
+		sr.Deserialize ("KernelCryptoNoReadWorkqueue", KernelCryptoNoReadWorkqueue);
+		sr.Deserialize ("KernelCryptoNoWriteWorkqueue", KernelCryptoNoWriteWorkqueue);
+		sr.Deserialize ("KernelCryptoSameCpu", KernelCryptoSameCpu);
+		sr.Deserialize ("KernelCryptoSubmitFromCryptCpus", KernelCryptoSubmitFromCryptCpus);
+
+		CachedPasswords.clear();
+		for (uint32 i = sr.DeserializeUInt32 ("CachedPasswordCount"); i > 0; --i)
+			CachedPasswords.push_back (Serializable::DeserializeNew <VolumePassword> (stream));
 	}
 
 	void MountOptions::Serialize (shared_ptr <Stream> stream) const
@@ -179,6 +210,25 @@ namespace VeraCrypt
 
 		sr.Serialize ("Pim", Pim);
 		sr.Serialize ("ProtectionPim", ProtectionPim);
+
+		sr.Serialize ("HintEncryptionAlgorithmName", Hint.EncryptionAlgorithmName);
+		sr.Serialize ("HintKdfName", Hint.KdfName);
+		sr.Serialize ("HintType", static_cast <uint32> (Hint.Type));
+
+		sr.Serialize ("HeaderKeyCacheTimeout", HeaderKeyCacheTimeout);
+		sr.Serialize ("ReadAheadSize", ReadAheadSize);
+		sr.Serialize ("SectorCacheSize", SectorCacheSize);
+		sr.Serialize ("WriteBackSize", WriteBackSize);
+		sr.Serialize ("DirectIo", DirectIo);
+		sr.Serialize ("AllowDiscards", AllowDiscards);
+		sr.Serialize ("KernelCryptoNoReadWorkqueue", KernelCryptoNoReadWorkqueue);
+		sr.Serialize ("KernelCryptoNoWriteWorkqueue", KernelCryptoNoWriteWorkqueue);
+		sr.Serialize ("KernelCryptoSameCpu", KernelCryptoSameCpu);
+		sr.Serialize ("KernelCryptoSubmitFromCryptCpus", KernelCryptoSubmitFromCryptCpus);
+
+		sr.Serialize ("CachedPasswordCount", static_cast <uint32> (CachedPasswords.size()));
+		foreach (shared_ptr <VolumePassword> password, CachedPasswords)
+			password->Serialize (stream);
 	}
 
 	TC_SERIALIZER_FACTORY_ADD_CLASS (MountOptions);
@@ -18,6 +18,7 @@
 #include "Volume/Volume.h"
 #include "Volume/VolumeSlot.h"
 #include "Volume/VolumePassword.h"
+#include "Volume/VolumePasswordCache.h"
 
 namespace VeraCrypt
 {
@@ -25,7 +26,14 @@ namespace VeraCrypt
 	{
 		MountOptions ()
 			:
+			AllowDiscards (false),
 			CachePassword (false),
+			DirectIo (false),
+			HeaderKeyCacheTimeout (0),
+			KernelCryptoNoReadWorkqueue (true),
+			KernelCryptoNoWriteWorkqueue (true),
+			KernelCryptoSameCpu (false),
+			KernelCryptoSubmitFromCryptCpus (false),
 			NoFilesystem (false),
 			NoHardwareCrypto (false),
 			NoKernelCrypto (false),
@@ -34,11 +42,14 @@ namespace VeraCrypt
 			PreserveTimestamps (true),
 			Protection (VolumeProtection::None),
 			ProtectionPim (-1),
+			ReadAheadSize (4),
 			Removable (false),
+			SectorCacheSize (0),
 			SharedAccessAllowed (false),
 			SlotNumber (0),
 			UseBackupHeaders (false),
-			TrueCryptMode (false)
+			TrueCryptMode (false),
+			WriteBackSize (0)
 		{
 		}
 
@@ -49,9 +60,18 @@ namespace VeraCrypt
 
 		TC_SERIALIZABLE (MountOptions);
 
+		bool AllowDiscards;
 		bool CachePassword;
+		CachedPasswordList CachedPasswords;
+		bool DirectIo;
 		wstring FilesystemOptions;
 		wstring FilesystemType;
+		int HeaderKeyCacheTimeout;
+		VolumeOpenHint Hint;
+		bool KernelCryptoNoReadWorkqueue; // Used only if supported by the kernel
+		bool KernelCryptoNoWriteWorkqueue;
+		bool KernelCryptoSameCpu;
+		bool KernelCryptoSubmitFromCryptCpus;
 		shared_ptr <KeyfileList> Keyfiles;
 		shared_ptr <DirectoryPath> MountPoint;
 		bool NoFilesystem;
@@ -68,11 +88,14 @@ namespace VeraCrypt
 		int ProtectionPim;
 		shared_ptr <Pkcs5Kdf> ProtectionKdf;
 		shared_ptr <KeyfileList> ProtectionKeyfiles;
+		int ReadAheadSize; // Megabytes
 		bool Removable;
+		int SectorCacheSize; // Megabytes
 		bool SharedAccessAllowed;
 		VolumeSlotNumber SlotNumber;
 		bool UseBackupHeaders;
 		bool TrueCryptMode;
+		int WriteBackSize; // Megabytes
 
 	protected:
 		void CopyFrom (const MountOptions &other);
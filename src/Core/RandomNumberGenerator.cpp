@@ -156,8 +156,17 @@ namespace VeraCrypt
 
 	void RandomNumberGenerator::SetHash (shared_ptr <Hash> hash)
 	{
-		ScopeLock lock (AccessMutex);
-		PoolHash = hash;
+		// Hashes of key derivation functions which are not available hash algorithms (BLAKE2b of Argon2id)
+		// leave the current pool hash in place
+		foreach (shared_ptr <Hash> availableHash, Hash::GetAvailableAlgorithms())
+		{
+			if (typeid (*availableHash) == typeid (*hash))
+			{
+				ScopeLock lock (AccessMutex);
+				PoolHash = hash;
+				return;
+			}
+		}
 	}
 
 	void RandomNumberGenerator::Start ()
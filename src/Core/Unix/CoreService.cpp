@@ -19,6 +19,7 @@
 #include "Platform/SystemLog.h"
 #include "Platform/Thread.h"
 #include "Platform/Unix/Poller.h"
+#include "Volume/VolumePasswordCache.h"
 #include "Core/Core.h"
 #include "CoreUnix.h"
 #include "CoreServiceRequest.h"
@@ -207,6 +208,22 @@ namespace VeraCrypt
 						continue;
 					}
 
+					// WipePasswordCacheRequest
+					if (dynamic_cast <WipePasswordCacheRequest*> (request.get()) != nullptr)
+					{
+						// Header keys are cached by the process which mounted the volumes
+						VolumePasswordCache::Clear();
+
+						if (!ElevatedPrivileges && ElevatedServiceAvailable)
+						{
+							request->Serialize (ServiceInputStream);
+							GetResponse <WipePasswordCacheResponse>();
+						}
+
+						WipePasswordCacheResponse().Serialize (outputStream);
+						continue;
+					}
+
 					throw ParameterIncorrect (SRC_POS);
 				}
 				catch (Exception &e)
@@ -317,6 +334,12 @@ namespace VeraCrypt
 		return GetResponse <T>();
 	}
 
+	void CoreService::RequestWipePasswordCache ()
+	{
+		WipePasswordCacheRequest request;
+		SendRequest <WipePasswordCacheResponse> (request);
+	}
+
 	void CoreService::Start ()
 	{
 		InputPipe.reset (new Pipe());
@@ -34,6 +34,7 @@ namespace VeraCrypt
 		static HostDeviceList RequestGetHostDevices (bool pathListOnly);
 		static shared_ptr <VolumeInfo> RequestMountVolume (MountOptions &options);
 		static void RequestSetFileOwner (const FilesystemPath &path, const UserId &owner);
+		static void RequestWipePasswordCache ();
 		static void SetAdminPasswordCallback (shared_ptr <GetStringFunctor> functor) { AdminPasswordCallback = functor; }
 		static void Start ();
 		static void Stop ();
@@ -22,7 +22,7 @@ namespace VeraCrypt
 	class CoreServiceProxy : public T
 	{
 	public:
-		CoreServiceProxy () { }
+		CoreServiceProxy () : HeaderKeyCacheUsed (false) { }
 		virtual ~CoreServiceProxy () { }
 
 		virtual void CheckFilesystem (shared_ptr <VolumeInfo> mountedVolume, bool repair) const
@@ -64,7 +64,7 @@ namespace VeraCrypt
 				return CoreService::RequestGetHostDevices (pathListOnly);
 		}
 #endif
-		virtual bool IsPasswordCacheEmpty () const { return VolumePasswordCache::IsEmpty(); }
+		virtual bool IsPasswordCacheEmpty () const { return VolumePasswordCache::IsEmpty() && !HeaderKeyCacheUsed; }
 
 		virtual shared_ptr <VolumeInfo> MountVolume (MountOptions &options)
 		{
@@ -74,25 +74,12 @@ namespace VeraCrypt
 				&& (!options.Password || options.Password->IsEmpty())
 				&& (!options.Keyfiles || options.Keyfiles->empty()))
 			{
-				finally_do_arg (MountOptions*, &options, { if (finally_arg->Password) finally_arg->Password.reset(); });
+				finally_do_arg (MountOptions*, &options, { if (finally_arg->Password) finally_arg->Password.reset(); finally_arg->CachedPasswords.clear(); });
 
-				PasswordIncorrect passwordException;
-				foreach (shared_ptr <VolumePassword> password, VolumePasswordCache::GetPasswords())
-				{
-					try
-					{
-						options.Password = password;
-						mountedVolume = CoreService::RequestMountVolume (options);
-						break;
-					}
-					catch (PasswordIncorrect &e)
-					{
-						passwordException = e;
-					}
-				}
-
-				if (!mountedVolume)
-					passwordException.Throw();
+				// Cached passwords are tested concurrently by the service in a single request
+				options.Password.reset();
+				options.CachedPasswords = VolumePasswordCache::GetPasswords();
+				mountedVolume = CoreService::RequestMountVolume (options);
 			}
 			else
 			{
@@ -130,6 +117,9 @@ namespace VeraCrypt
 				}
 			}
 
+			if (options.HeaderKeyCacheTimeout > 0)
+				HeaderKeyCacheUsed = true;
+
 			VolumeEventArgs eventArgs (mountedVolume);
 			T::VolumeMountedEvent.Raise (eventArgs);
 
@@ -149,7 +139,12 @@ namespace VeraCrypt
 		virtual void WipePasswordCache () const
 		{
 			VolumePasswordCache::Clear();
+			CoreService::RequestWipePasswordCache();
+			HeaderKeyCacheUsed = false;
 		}
+
+	protected:
+		mutable bool HeaderKeyCacheUsed;
 	};
 }
 
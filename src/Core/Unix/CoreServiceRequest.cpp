@@ -260,6 +260,17 @@ namespace VeraCrypt
 	}
 
 
+	// WipePasswordCacheRequest
+	void WipePasswordCacheRequest::Deserialize (shared_ptr <Stream> stream)
+	{
+		CoreServiceRequest::Deserialize (stream);
+	}
+
+	void WipePasswordCacheRequest::Serialize (shared_ptr <Stream> stream) const
+	{
+		CoreServiceRequest::Serialize (stream);
+	}
+
 	TC_SERIALIZER_FACTORY_ADD_CLASS (CoreServiceRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (CheckFilesystemRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (DismountFilesystemRequest);
@@ -270,4 +281,5 @@ namespace VeraCrypt
 	TC_SERIALIZER_FACTORY_ADD_CLASS (GetHostDevicesRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (MountVolumeRequest);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (SetFileOwnerRequest);
+	TC_SERIALIZER_FACTORY_ADD_CLASS (WipePasswordCacheRequest);
 }
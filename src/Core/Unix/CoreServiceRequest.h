@@ -135,6 +135,11 @@ namespace VeraCrypt
 		UserId Owner;
 		FilesystemPath Path;
 	};
+
+	struct WipePasswordCacheRequest : CoreServiceRequest
+	{
+		TC_SERIALIZABLE (WipePasswordCacheRequest);
+	};
 }
 
 #endif // TC_HEADER_Core_Unix_CoreServiceRequest
@@ -112,6 +112,16 @@ namespace VeraCrypt
 		Serializable::Serialize (stream);
 	}
 
+	// WipePasswordCacheResponse
+	void WipePasswordCacheResponse::Deserialize (shared_ptr <Stream> stream)
+	{
+	}
+
+	void WipePasswordCacheResponse::Serialize (shared_ptr <Stream> stream) const
+	{
+		Serializable::Serialize (stream);
+	}
+
 	TC_SERIALIZER_FACTORY_ADD_CLASS (CheckFilesystemResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (DismountFilesystemResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (DismountVolumeResponse);
@@ -120,4 +130,5 @@ namespace VeraCrypt
 	TC_SERIALIZER_FACTORY_ADD_CLASS (GetHostDevicesResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (MountVolumeResponse);
 	TC_SERIALIZER_FACTORY_ADD_CLASS (SetFileOwnerResponse);
+	TC_SERIALIZER_FACTORY_ADD_CLASS (WipePasswordCacheResponse);
 }
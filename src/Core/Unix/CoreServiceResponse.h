@@ -83,6 +83,12 @@ namespace VeraCrypt
 		SetFileOwnerResponse () { }
 		TC_SERIALIZABLE (SetFileOwnerResponse);
 	};
+
+	struct WipePasswordCacheResponse : CoreServiceResponse
+	{
+		WipePasswordCacheResponse () { }
+		TC_SERIALIZABLE (WipePasswordCacheResponse);
+	};
 }
 
 #endif // TC_HEADER_Core_Unix_CoreServiceResponse
@@ -20,6 +20,7 @@
 #include <unistd.h>
 #include "Platform/FileStream.h"
 #include "Driver/Fuse/FuseService.h"
+#include "Volume/VolumeHeaderKeyCache.h"
 #include "Volume/VolumePasswordCache.h"
 
 namespace VeraCrypt
@@ -108,6 +109,8 @@ namespace VeraCrypt
 
 	shared_ptr <VolumeInfo> CoreUnix::DismountVolume (shared_ptr <VolumeInfo> mountedVolume, bool ignoreOpenFiles, bool syncVolumeInfo)
 	{
+		VolumeHeaderKeyCache::RemoveExpired();
+
 		if (!mountedVolume->MountPoint.IsEmpty())
 		{
 			DismountFilesystem (mountedVolume->MountPoint, ignoreOpenFiles);
@@ -130,6 +133,12 @@ namespace VeraCrypt
 				DetachLoopDevice (mountedVolume->LoopDevice);
 			}
 			catch (ExecutedProcessFailed&) { }
+			catch (SystemException &e)
+			{
+				// The loop device has already been released
+				if (e.GetErrorCode() != ENXIO)
+					throw;
+			}
 		}
 
 		if (syncVolumeInfo || mountedVolume->Protection == VolumeProtection::HiddenVolumeReadOnly)
@@ -428,6 +437,12 @@ namespace VeraCrypt
 
 		Cipher::EnableHwSupport (!options.NoHardwareCrypto);
 
+		VolumeHeaderKeyCache::SetTimeToLive (options.HeaderKeyCacheTimeout > 0 ? options.HeaderKeyCacheTimeout : 0);
+		finally_do ({ VolumeHeaderKeyCache::SetTimeToLive (0); });
+
+		if ((!options.Password || options.Password->IsEmpty()) && !options.CachedPasswords.empty())
+			SelectCachedPassword (options);
+
 		shared_ptr <Volume> volume;
 
 		while (true)
@@ -450,7 +465,8 @@ namespace VeraCrypt
 					options.SharedAccessAllowed,
 					VolumeType::Unknown,
 					options.UseBackupHeaders,
-					options.PartitionInSystemEncryptionScope
+					options.PartitionInSystemEncryptionScope,
+					options.Hint
 					);
 
 				options.Password.reset();
@@ -477,6 +493,10 @@ namespace VeraCrypt
 				throw ParameterIncorrect (SRC_POS);
 		}
 
+		// Direct I/O is an optimization; hosts which do not support it are accessed through the system cache
+		if (options.DirectIo)
+			volume->EnableDirectIo();
+
 		// Find a free mount point for FUSE service
 		MountedFilesystemList mountedFilesystems = GetMountedFilesystems ();
 		string fuseMountPoint;
@@ -519,7 +539,11 @@ namespace VeraCrypt
 
 		try
 		{
-			FuseService::Mount (volume, options.SlotNumber, fuseMountPoint);
+			FuseService::Mount (volume, options.SlotNumber, fuseMountPoint,
+				static_cast <uint64> (max (options.SectorCacheSize, 0)) * BYTES_PER_MB,
+				static_cast <uint64> (max (options.ReadAheadSize, 0)) * BYTES_PER_MB,
+				static_cast <uint64> (max (options.WriteBackSize, 0)) * BYTES_PER_MB,
+				options.AllowDiscards && options.Protection == VolumeProtection::None);
 		}
 		catch (...)
 		{
@@ -562,7 +586,7 @@ namespace VeraCrypt
 				}
 				catch (NotApplicable&)
 				{
-					MountAuxVolumeImage (fuseMountPoint, options);
+					MountAuxVolumeImage (fuseMountPoint, options, volume->GetSectorSize());
 				}
 			}
 			catch (...)
@@ -614,9 +638,10 @@ namespace VeraCrypt
 		return mountedVolumes.front();
 	}
 
-	void CoreUnix::MountAuxVolumeImage (const DirectoryPath &auxMountPoint, const MountOptions &options) const
+	void CoreUnix::MountAuxVolumeImage (const DirectoryPath &auxMountPoint, const MountOptions &options, size_t sectorSize) const
 	{
-		DevicePath loopDev = AttachFileToLoopDevice (string (auxMountPoint) + FuseService::GetVolumeImagePath(), options.Protection == VolumeProtection::ReadOnly);
+		// Data of the volume image is cached above the loop device, so the image itself is read and written directly
+		DevicePath loopDev = AttachFileToLoopDevice (string (auxMountPoint) + FuseService::GetVolumeImagePath(), options.Protection == VolumeProtection::ReadOnly, true, sectorSize);
 
 		try
 		{
@@ -641,6 +666,115 @@ namespace VeraCrypt
 		}
 	}
 
+	void CoreUnix::SelectCachedPassword (MountOptions &options) const
+	{
+		CachedPasswordList candidates;
+		candidates.swap (options.CachedPasswords);
+
+		if (candidates.size() == 1)
+		{
+			options.Password = candidates.front();
+			return;
+		}
+
+		// Test cached passwords concurrently by opening the volume read-only. The first password
+		// found wins and aborts the remaining trials; its layout, KDF and algorithm are passed on
+		// as a hint so that the volume is then opened for mounting with a single key derivation.
+		struct TrialContext
+		{
+			TrialContext (const MountOptions &options, const CachedPasswordList &candidates)
+				: Aborted (false), Candidates (candidates), Options (options) { }
+
+			volatile bool Aborted;
+			CachedPasswordList Candidates;
+			Mutex ContextMutex;
+			shared_ptr <VolumePassword> FoundPassword;
+			VolumeOpenHint FoundHint;
+			const MountOptions &Options;
+			auto_ptr <Exception> TrialException;
+		};
+
+		struct TrialFunctor : public Functor
+		{
+			TrialFunctor (TrialContext &context) : Context (context) { }
+
+			virtual void operator() ()
+			{
+				const MountOptions &options = Context.Options;
+
+				while (true)
+				{
+					shared_ptr <VolumePassword> password;
+					{
+						ScopeLock lock (Context.ContextMutex);
+						if (Context.FoundPassword || Context.Candidates.empty())
+							return;
+
+						password = Context.Candidates.front();
+						Context.Candidates.pop_front();
+					}
+
+					try
+					{
+						Volume volume;
+						volume.Open (*options.Path, options.PreserveTimestamps, password, options.Pim, options.Kdf, options.TrueCryptMode, shared_ptr <KeyfileList> (),
+							VolumeProtection::ReadOnly, shared_ptr <VolumePassword> (), 0, shared_ptr <Pkcs5Kdf> (), shared_ptr <KeyfileList> (),
+							true, VolumeType::Unknown, options.UseBackupHeaders, options.PartitionInSystemEncryptionScope, options.Hint, &Context.Aborted);
+
+						ScopeLock lock (Context.ContextMutex);
+						if (!Context.FoundPassword)
+						{
+							Context.FoundPassword = password;
+							Context.FoundHint = VolumeOpenHint (volume.GetType(), volume.GetPkcs5Kdf()->GetName(), volume.GetEncryptionAlgorithm()->GetName());
+							__atomic_store_n (&Context.Aborted, true, __ATOMIC_RELEASE);
+						}
+					}
+					catch (UserAbort &)
+					{
+						return;
+					}
+					catch (Exception &e)
+					{
+						ScopeLock lock (Context.ContextMutex);
+						if (!Context.TrialException.get() || (dynamic_cast <PasswordException *> (Context.TrialException.get()) && !dynamic_cast <PasswordException *> (&e)))
+							Context.TrialException.reset (e.CloneNew());
+					}
+				}
+			}
+
+			TrialContext &Context;
+		};
+
+		TrialContext context (options, candidates);
+
+		long cpuCount = sysconf (_SC_NPROCESSORS_ONLN);
+		size_t threadCount = (size_t) (cpuCount > 1 ? cpuCount : 1);
+		if (threadCount > candidates.size())
+			threadCount = candidates.size();
+
+		list < shared_ptr <Thread> > threads;
+		for (size_t i = 0; i < threadCount; ++i)
+		{
+			make_shared_auto (Thread, thread);
+			thread->Start (new TrialFunctor (context));
+			threads.push_back (thread);
+		}
+
+		foreach (shared_ptr <Thread> thread, threads)
+			thread->Join();
+
+		if (!context.FoundPassword)
+		{
+			if (context.TrialException.get())
+				context.TrialException->Throw();
+
+			throw PasswordIncorrect (SRC_POS);
+		}
+
+		options.Password = context.FoundPassword;
+		options.Hint = context.FoundHint;
+	}
+
 	void CoreUnix::SetFileOwner (const FilesystemPath &path, const UserId &owner) const
 	{
 		throw_sys_if (chown (string (path).c_str(), owner.SystemId, (gid_t) -1) == -1);
@@ -50,7 +50,7 @@ namespace VeraCrypt
 		virtual void WipePasswordCache () const { throw NotApplicable (SRC_POS); }
 
 	protected:
-		virtual DevicePath AttachFileToLoopDevice (const FilePath &filePath, bool readOnly) const { throw NotApplicable (SRC_POS); }
+		virtual DevicePath AttachFileToLoopDevice (const FilePath &filePath, bool readOnly, bool directIo = false, size_t logicalBlockSize = 0) const { throw NotApplicable (SRC_POS); }
 		virtual void DetachLoopDevice (const DevicePath &devicePath) const { throw NotApplicable (SRC_POS); }
 		virtual void DismountNativeVolume (shared_ptr <VolumeInfo> mountedVolume) const { throw NotApplicable (SRC_POS); }
 		virtual bool FilesystemSupportsUnixPermissions (const DevicePath &devicePath) const;
@@ -61,8 +61,9 @@ namespace VeraCrypt
 		virtual gid_t GetRealGroupId () const;
 		virtual string GetTempDirectory () const;
 		virtual void MountFilesystem (const DevicePath &devicePath, const DirectoryPath &mountPoint, const string &filesystemType, bool readOnly, const string &systemMountOptions) const;
-		virtual void MountAuxVolumeImage (const DirectoryPath &auxMountPoint, const MountOptions &options) const;
+		virtual void MountAuxVolumeImage (const DirectoryPath &auxMountPoint, const MountOptions &options, size_t sectorSize) const;
 		virtual void MountVolumeNative (shared_ptr <Volume> volume, MountOptions &options, const DirectoryPath &auxMountPoint) const { throw NotApplicable (SRC_POS); }
+		virtual void SelectCachedPassword (MountOptions &options) const;
 
 	private:
 		CoreUnix (const CoreUnix &);
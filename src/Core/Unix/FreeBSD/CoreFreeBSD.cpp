@@ -30,7 +30,7 @@ namespace VeraCrypt
 	{
 	}
 
-	DevicePath CoreFreeBSD::AttachFileToLoopDevice (const FilePath &filePath, bool readOnly) const
+	DevicePath CoreFreeBSD::AttachFileToLoopDevice (const FilePath &filePath, bool readOnly, bool directIo, size_t logicalBlockSize) const
 	{
 		list <string> args;
 		args.push_back ("-a");
@@ -16,17 +16,319 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <sys/ioctl.h>
 #include <sys/mount.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <sys/wait.h>
+#include <linux/dm-ioctl.h>
+#include <linux/loop.h>
 #include "CoreLinux.h"
+#include "Platform/Memory.h"
 #include "Platform/SystemInfo.h"
 #include "Platform/TextReader.h"
 #include "Volume/EncryptionModeXTS.h"
 #include "Driver/Fuse/FuseService.h"
 #include "Core/Unix/CoreServiceProxy.h"
 
+#ifndef LOOP_CTL_GET_FREE
+#	define LOOP_CTL_GET_FREE 0x4C82
+#endif
+
+#ifndef LOOP_SET_DIRECT_IO
+#	define LOOP_SET_DIRECT_IO 0x4C08
+#	define LO_FLAGS_DIRECT_IO 16
+#endif
+
+#ifndef LOOP_SET_BLOCK_SIZE
+#	define LOOP_SET_BLOCK_SIZE 0x4C09
+#endif
+
+#ifndef LOOP_CONFIGURE
+#	define LOOP_CONFIGURE 0x4C0A
+#endif
+
+#ifndef DM_UEVENT_GENERATED_FLAG
+#	define DM_UEVENT_GENERATED_FLAG (1 << 13)
+#endif
+
+#ifndef DM_SECURE_DATA_FLAG
+#	define DM_SECURE_DATA_FLAG (1 << 15)
+#endif
+
 namespace VeraCrypt
 {
+	namespace
+	{
+		// Argument of LOOP_CONFIGURE (struct loop_config), which is missing in older kernel headers
+		struct LoopConfig
+		{
+			uint32 fd;
+			uint32 block_size;
+			struct loop_info64 info;
+			uint64 reserved[8];
+		};
+
+		// Creates and removes device-mapper devices through the control device. Uevents of the devices are
+		// synchronized with udev using the cookie semaphore protocol of libdevmapper, whose udev rules signal
+		// the semaphore once the device nodes have been processed.
+		class DeviceMapperControl
+		{
+		public:
+			DeviceMapperControl ();
+			~DeviceMapperControl ();
+
+			dev_t CreateDevice (const string &name, const ConstBufferPtr &cryptParameters, uint64 sectorCount);
+			bool RemoveDevice (const string &name);
+			void WaitForDeviceNodes ();
+
+		protected:
+			void CreateCookie ();
+			void Execute (unsigned long request, const string &name, const BufferPtr &buffer, bool generatesUevent);
+			static string GetNodePath (const string &name) { return "/dev/mapper/" + name; }
+
+			File Control;
+			uint32 Cookie;
+			int CookieSemaphore;
+			map <string, dev_t> CreatedDevices;
+			list <string> RemovedDevices;
+
+			static const uint32 CookieMagic = 0x0D4D;
+			static const uint32 UdevPrimarySourceFlag = 0x0040;
+			static const int UdevFlagsShift = 16;
+
+		private:
+			DeviceMapperControl (const DeviceMapperControl &);
+			DeviceMapperControl &operator= (const DeviceMapperControl &);
+		};
+
+		DeviceMapperControl::DeviceMapperControl () : Cookie (0), CookieSemaphore (-1)
+		{
+			try
+			{
+				Control.Open ("/dev/mapper/control", File::OpenReadWrite);
+			}
+			catch (SystemException&)
+			{
+				// Load device mapper kernel module
+				foreach (const string &dmModule, StringConverter::Split ("dm_mod dm-mod dm"))
+				{
+					list <string> execArgs;
+					execArgs.push_back (dmModule);
+
+					try
+					{
+						Process::Execute ("modprobe", execArgs);
+						break;
+					}
+					catch (...) { }
+				}
+
+				Control.Open ("/dev/mapper/control", File::OpenReadWrite);
+			}
+
+			// Without a running udev daemon, device nodes are created directly
+			if (access ("/run/udev/control", F_OK) == 0)
+			{
+				try
+				{
+					CreateCookie();
+				}
+				catch (...) { }
+			}
+		}
+
+		DeviceMapperControl::~DeviceMapperControl ()
+		{
+			if (CookieSemaphore != -1)
+				semctl (CookieSemaphore, 0, IPC_RMID);
+		}
+
+		dev_t DeviceMapperControl::CreateDevice (const string &name, const ConstBufferPtr &cryptParameters, uint64 sectorCount)
+		{
+			SecureBuffer buffer (sizeof (struct dm_ioctl));
+			Execute (DM_DEV_CREATE, name, buffer, false);
+
+			struct dm_ioctl header;
+			memcpy (&header, buffer.Ptr(), sizeof (header));
+			dev_t device = static_cast <dev_t> (header.dev);
+
+			try
+			{
+				// The table is passed in a single target specification, which is followed by its parameters
+				size_t tableSize = sizeof (struct dm_ioctl) + sizeof (struct dm_target_spec) + cryptParameters.Size() + 1;
+				tableSize = (tableSize + 7) & ~static_cast <size_t> (7);
+
+				SecureBuffer table (tableSize);
+				table.Zero();
+
+				struct dm_target_spec target;
+				Memory::Zero (&target, sizeof (target));
+				target.length = sectorCount;
+				strcpy (target.target_type, "crypt");
+
+				memcpy (table.Ptr() + sizeof (struct dm_ioctl), &target, sizeof (target));
+				table.GetRange (sizeof (struct dm_ioctl) + sizeof (target), cryptParameters.Size()).CopyFrom (cryptParameters);
+
+				Execute (DM_TABLE_LOAD, name, table, false);
+
+				// Resuming the device activates the loaded table
+				SecureBuffer resume (sizeof (struct dm_ioctl));
+				Execute (DM_DEV_SUSPEND, name, resume, true);
+			}
+			catch (...)
+			{
+				try
+				{
+					RemoveDevice (name);
+				}
+				catch (...) { }
+
+				throw;
+			}
+
+			CreatedDevices[name] = device;
+			return device;
+		}
+
+		void DeviceMapperControl::CreateCookie ()
+		{
+			// The semaphore key is derived from the cookie, which udev rules pass to dmsetup to signal completion
+			uint32 base = static_cast <uint32> (getpid() ^ time (nullptr));
+
+			for (int i = 0; i < 0x10000; ++i)
+			{
+				uint32 cookie = (base + i) & 0xffff;
+				if (cookie == 0)
+					continue;
+
+				int semaphore = semget ((CookieMagic << 16) | cookie, 1, 0600 | IPC_CREAT | IPC_EXCL);
+				if (semaphore == -1)
+				{
+					throw_sys_if (errno != EEXIST);
+					continue;
+				}
+
+				if (semctl (semaphore, 0, SETVAL, 1) == -1)
+				{
+					int error = errno;
+					semctl (semaphore, 0, IPC_RMID);
+					throw SystemException (SRC_POS, error);
+				}
+
+				CookieSemaphore = semaphore;
+				Cookie = (UdevPrimarySourceFlag << UdevFlagsShift) | cookie;
+				return;
+			}
+
+			throw ParameterIncorrect (SRC_POS);
+		}
+
+		void DeviceMapperControl::Execute (unsigned long request, const string &name, const BufferPtr &buffer, bool generatesUevent)
+		{
+			if (name.size() >= DM_NAME_LEN)
+				throw ParameterIncorrect (SRC_POS);
+
+			struct dm_ioctl header;
+			Memory::Zero (&header, sizeof (header));
+			header.version[0] = DM_VERSION_MAJOR;
+			header.data_size = static_cast <uint32> (buffer.Size());
+			header.data_start = sizeof (header);
+			header.flags = DM_SECURE_DATA_FLAG;
+			strcpy (header.name, name.c_str());
+
+			if (request == DM_TABLE_LOAD)
+				header.target_count = 1;
+
+			// Each pending uevent holds a reference to the cookie semaphore until udev has processed it
+			bool cookieUsed = generatesUevent && CookieSemaphore != -1;
+			if (cookieUsed)
+			{
+				struct sembuf increment = { 0, 1, 0 };
+				throw_sys_if (semop (CookieSemaphore, &increment, 1) == -1);
+				header.event_nr = Cookie;
+			}
+
+			memcpy (buffer.Get(), &header, sizeof (header));
+			int result = ioctl (Control.GetSystemHandle(), request, buffer.Get());
+			int error = errno;
+
+			memcpy (&header, buffer.Get(), sizeof (header));
+			if (cookieUsed && (result == -1 || !(header.flags & DM_UEVENT_GENERATED_FLAG)))
+			{
+				struct sembuf decrement = { 0, -1, IPC_NOWAIT };
+				semop (CookieSemaphore, &decrement, 1);
+			}
+
+			if (result == -1)
+			{
+				errno = error;
+				throw_sys_sub_if (true, StringConverter::ToWide (name));
+			}
+		}
+
+		bool DeviceMapperControl::RemoveDevice (const string &name)
+		{
+			SecureBuffer buffer (sizeof (struct dm_ioctl));
+
+			try
+			{
+				Execute (DM_DEV_REMOVE, name, buffer, true);
+			}
+			catch (SystemException &e)
+			{
+				if (e.GetErrorCode() == EBUSY)
+					return false;
+
+				// The device does not exist
+				if (e.GetErrorCode() != ENXIO)
+					throw;
+			}
+
+			CreatedDevices.erase (name);
+			RemovedDevices.push_back (name);
+			return true;
+		}
+
+		void DeviceMapperControl::WaitForDeviceNodes ()
+		{
+			if (CookieSemaphore != -1)
+			{
+				// The initial reference is released and the pending uevents are waited for
+				struct sembuf decrement = { 0, -1, IPC_NOWAIT };
+				struct sembuf waitForZero = { 0, 0, 0 };
+				struct timespec timeout = { 10, 0 };
+
+				if (semop (CookieSemaphore, &decrement, 1) != -1)
+					semtimedop (CookieSemaphore, &waitForZero, 1, &timeout);
+
+				semctl (CookieSemaphore, 0, IPC_RMID);
+				CookieSemaphore = -1;
+			}
+
+			// Device nodes are managed directly when udev is not running or has not processed the uevents
+			typedef pair <string, dev_t> CreatedDevice;
+			foreach (const CreatedDevice &device, CreatedDevices)
+			{
+				string nodePath = GetNodePath (device.first);
+				if (!FilesystemPath (nodePath).IsBlockDevice())
+					throw_sys_sub_if (mknod (nodePath.c_str(), S_IFBLK | 0600, device.second) == -1 && errno != EEXIST, StringConverter::ToWide (nodePath));
+			}
+
+			foreach (const string &name, RemovedDevices)
+			{
+				if (FilesystemPath (GetNodePath (name)).IsBlockDevice())
+					unlink (GetNodePath (name).c_str());
+			}
+
+			CreatedDevices.clear();
+			RemovedDevices.clear();
+		}
+	}
+
 	CoreLinux::CoreLinux ()
 	{
 	}
@@ -35,91 +337,124 @@ namespace VeraCrypt
 	{
 	}
 
-	DevicePath CoreLinux::AttachFileToLoopDevice (const FilePath &filePath, bool readOnly) const
+	DevicePath CoreLinux::AttachFileToLoopDevice (const FilePath &filePath, bool readOnly, bool directIo, size_t logicalBlockSize) const
 	{
 		list <string> loopPaths;
 		loopPaths.push_back ("/dev/loop");
 		loopPaths.push_back ("/dev/loop/");
 		loopPaths.push_back ("/dev/.static/dev/loop");
 
-		// On Fedora 23,"losetup -f" must be called first to create a default loop device
-		list <string> args;
-		args.push_back ("-f");
+		File backingFile;
+		backingFile.Open (filePath, readOnly ? File::OpenRead : File::OpenReadWrite);
 
+		// Free loop devices are allocated by the loop control device (Linux 3.1 and later). Older kernels only
+		// provide a fixed set of devices, which are tried in turn.
+		File loopControl;
 		try
 		{
-			Process::Execute ("losetup", args);
+			loopControl.Open ("/dev/loop-control", File::OpenReadWrite);
 		}
-		catch (...) { }
+		catch (SystemException&) { }
 
 		for (int devIndex = 0; devIndex < 256; devIndex++)
 		{
-			string loopDev;
-			foreach (const string &loopPath, loopPaths)
+			int loopIndex = devIndex;
+			if (loopControl.IsOpen())
 			{
-				loopDev = loopPath + StringConverter::ToSingle (devIndex);
-				if (FilesystemPath (loopDev).IsBlockDevice())
-					break;
+				loopIndex = ioctl (loopControl.GetSystemHandle(), LOOP_CTL_GET_FREE);
+				throw_sys_sub_if (loopIndex == -1, wstring (filePath));
 			}
 
-			if (loopDev.empty())
-				continue;
+			// The device node of a newly allocated device may be created by udev with a delay
+			string loopDev;
+			for (int t = 0; loopDev.empty() && t < (loopControl.IsOpen() ? 20 : 1); t++)
+			{
+				if (t > 0)
+					Thread::Sleep (50);
 
-			list <string> args;
+				foreach (const string &loopPath, loopPaths)
+				{
+					if (FilesystemPath (loopPath + StringConverter::ToSingle (loopIndex)).IsBlockDevice())
+					{
+						loopDev = loopPath + StringConverter::ToSingle (loopIndex);
+						break;
+					}
+				}
+			}
 
-			list <string>::iterator readOnlyArg;
-			if (readOnly)
+			// A device allocated by the loop control device would be returned again if skipped
+			if (loopDev.empty())
 			{
-				args.push_back ("-r");
-				readOnlyArg = --args.end();
+				if (loopControl.IsOpen())
+					break;
+				continue;
 			}
 
-			args.push_back ("--");
-			args.push_back (loopDev);
-			args.push_back (filePath);
-
+			File loopDevice;
 			try
 			{
-				Process::Execute ("losetup", args);
-				return loopDev;
+				loopDevice.Open (loopDev, readOnly ? File::OpenRead : File::OpenReadWrite);
 			}
-			catch (ExecutedProcessFailed&)
+			catch (SystemException&)
 			{
-				if (readOnly)
-				{
-					try
-					{
-						args.erase (readOnlyArg);
-						Process::Execute ("losetup", args);
-						return loopDev;
-					}
-					catch (ExecutedProcessFailed&) { }
-				}
+				if (loopControl.IsOpen())
+					throw;
+				continue;
+			}
+
+			// Another process may claim the device before it is configured, in which case the next free one is used
+			if (SetLoopDeviceBackingFile (loopDevice, backingFile, filePath, readOnly, directIo, logicalBlockSize))
+			{
+				ConfigureLoopDevice (loopDev, directIo);
+				return loopDev;
 			}
 		}
 
 		throw LoopDeviceSetupFailed (SRC_POS, wstring (filePath));
 	}
 
-	void CoreLinux::DetachLoopDevice (const DevicePath &devicePath) const
+	void CoreLinux::ConfigureLoopDevice (const DevicePath &loopDevice, bool directIo) const
 	{
-		list <string> args;
-		args.push_back ("-d");
-		args.push_back (devicePath);
+		if (!directIo)
+			return;
 
-		for (int t = 0; true; t++)
+		// Without the page cache of the backing file, read-ahead of the file system above the loop device is the
+		// only one; it is issued in requests of the maximum size accepted by the FUSE service. A short request queue
+		// limits the latency of synchronous requests queued behind read-ahead and write-back.
+		string queuePath = "/sys/block/" + StringConverter::Split (string (loopDevice), "/").back() + "/queue/";
+
+		map <string, uint64> queueSettings;
+		queueSettings["nr_requests"] = 64;
+		queueSettings["read_ahead_kb"] = FuseService::GetMaxRequestSize() / 1024;
+
+		typedef pair <string, uint64> QueueSetting;
+		foreach (const QueueSetting &setting, queueSettings)
 		{
 			try
 			{
-				Process::Execute ("losetup", args);
-				break;
-			}
-			catch (ExecutedProcessFailed&)
-			{
-				if (t > 5)
-					throw;
-				Thread::Sleep (200);
+				string value = StringConverter::ToSingle (setting.second);
+
+				File queueFile;
+				queueFile.Open (queuePath + setting.first, File::OpenWrite);
+				queueFile.Write (ConstBufferPtr ((const byte *) value.c_str(), value.size()));
 			}
+			catch (...) { }
+		}
+	}
+
+	void CoreLinux::DetachLoopDevice (const DevicePath &devicePath) const
+	{
+		File loopDevice;
+		loopDevice.Open (devicePath, File::OpenRead);
+
+		for (int t = 0; true; t++)
+		{
+			// A device without a backing file has already been detached
+			if (ioctl (loopDevice.GetSystemHandle(), LOOP_CLR_FD, 0) != -1 || errno == ENXIO)
+				break;
+
+			throw_sys_sub_if (errno != EBUSY || t > 5, wstring (devicePath));
+			Thread::Sleep (200);
 		}
 	}
 
@@ -130,34 +465,21 @@ namespace VeraCrypt
 		if (devPath.find ("/dev/mapper/veracrypt") != 0)
 			throw NotApplicable (SRC_POS);
 
+		DeviceMapperControl deviceMapper;
+
+		// Devices of a cascade are removed from the top
 		size_t devCount = 0;
 		while (FilesystemPath (devPath).IsBlockDevice())
 		{
-			list <string> dmsetupArgs;
-			dmsetupArgs.push_back ("remove");
-			dmsetupArgs.push_back (StringConverter::Split (devPath, "/").back());
-
-			for (int t = 0; true; t++)
+			for (int t = 0; !deviceMapper.RemoveDevice (StringConverter::Split (devPath, "/").back()); t++)
 			{
-				try
-				{
-					Process::Execute ("dmsetup", dmsetupArgs);
-					break;
-				}
-				catch (...)
-				{
-					if (t > 20)
-						throw;
+				if (t > 20)
+					throw SystemException (SRC_POS, EBUSY);
 
-					Thread::Sleep (100);
-				}
-			}
-
-			for (int t = 0; FilesystemPath (devPath).IsBlockDevice() && t < 20; t++)
-			{
 				Thread::Sleep (100);
 			}
 
+			deviceMapper.WaitForDeviceNodes();
 			devPath = string (mountedVolume->VirtualDevice) + "_" + StringConverter::ToSingle (devCount++);
 		}
 	}
@@ -322,23 +644,10 @@ namespace VeraCrypt
 		if (!SystemInfo::IsVersionAtLeast (2, 6, xts ? 24 : 20))
 			throw NotApplicable (SRC_POS);
 
-		// Load device mapper kernel module
-		list <string> execArgs;
-		foreach (const string &dmModule, StringConverter::Split ("dm_mod dm-mod dm"))
-		{
-			execArgs.clear();
-			execArgs.push_back (dmModule);
-
-			try
-			{
-				Process::Execute ("modprobe", execArgs);
-				break;
-			}
-			catch (...) { }
-		}
+		DeviceMapperControl deviceMapper;
 
 		bool loopDevAttached = false;
-		bool nativeDevCreated = false;
+		list <string> nativeDevNames;
 		bool filesystemMounted = false;
 
 		// Attach volume to loopback device if required
@@ -358,10 +667,12 @@ namespace VeraCrypt
 			size_t secondaryKeyOffset = volume->GetEncryptionMode()->GetKey().Size();
 			size_t cipherCount = volume->GetEncryptionAlgorithm()->GetCiphers().size();
 
+			dev_t lowerDev = 0;
+
+			// All layers of a cascade are created before udev is waited for, as each references the one below by its device number
 			foreach_reverse_ref (const Cipher &cipher, volume->GetEncryptionAlgorithm()->GetCiphers())
 			{
 				stringstream dmCreateArgs;
-				dmCreateArgs << "0 " << volume->GetSize() / ENCRYPTION_DATA_UNIT_SIZE << " crypt ";
 
 				// Mode
 				dmCreateArgs << StringConverter::ToLower (StringConverter::ToSingle (cipher.GetName())) << (xts ? (SystemInfo::IsVersionAtLeast (2, 6, 33) ? "-xts-plain64 " : "-xts-plain ") : "-lrw-benbi ");
@@ -376,7 +687,34 @@ namespace VeraCrypt
 				if (nativeDevCount == 0)
 					dmCreateArgs << string (volumePath) << ' ' << startSector;
 				else
-					dmCreateArgs << nativeDevPath << " 0";
+					dmCreateArgs << major (lowerDev) << ':' << minor (lowerDev) << " 0";
+
+				// Optional parameters, which are used only if supported by the kernel
+				list <string> optionalParams;
+
+				if (options.AllowDiscards && SystemInfo::IsVersionAtLeast (3, 1, 0))
+					optionalParams.push_back ("allow_discards");
+
+				if (options.KernelCryptoSameCpu && SystemInfo::IsVersionAtLeast (4, 0, 0))
+					optionalParams.push_back ("same_cpu_crypt");
+
+				if (options.KernelCryptoSubmitFromCryptCpus && SystemInfo::IsVersionAtLeast (4, 0, 0))
+					optionalParams.push_back ("submit_from_crypt_cpus");
+
+				// Earlier kernels support the workqueue flags, but may run crypto in atomic context when they are set
+				if (options.KernelCryptoNoReadWorkqueue && SystemInfo::IsVersionAtLeast (5, 12, 0))
+					optionalParams.push_back ("no_read_workqueue");
+
+				if (options.KernelCryptoNoWriteWorkqueue && SystemInfo::IsVersionAtLeast (5, 12, 0))
+					optionalParams.push_back ("no_write_workqueue");
+
+				// Crypto sectors remain 512 bytes (sector_size is not used) as data units of volumes are 512 bytes regardless of the sector size
+				if (!optionalParams.empty())
+				{
+					dmCreateArgs << ' ' << optionalParams.size();
+					foreach (const string &param, optionalParams)
+						dmCreateArgs << ' ' << param;
+				}
 
 				SecureBuffer dmCreateArgsBuf (dmCreateArgs.str().size());
 				dmCreateArgsBuf.CopyFrom (ConstBufferPtr ((byte *) dmCreateArgs.str().c_str(), dmCreateArgs.str().size()));
@@ -404,33 +742,14 @@ namespace VeraCrypt
 
 				nativeDevPath = "/dev/mapper/" + nativeDevName.str();
 
-				execArgs.clear();
-				execArgs.push_back ("create");
-				execArgs.push_back (nativeDevName.str());
-
-				Process::Execute ("dmsetup", execArgs, -1, nullptr, &dmCreateArgsBuf);
-
-				// Wait for the device to be created
-				for (int t = 0; true; t++)
-				{
-					try
-					{
-						FilesystemPath (nativeDevPath).GetType();
-						break;
-					}
-					catch (...)
-					{
-						if (t > 20)
-							throw;
-
-						Thread::Sleep (100);
-					}
-				}
+				lowerDev = deviceMapper.CreateDevice (nativeDevName.str(), dmCreateArgsBuf, volume->GetSize() / ENCRYPTION_DATA_UNIT_SIZE);
 
-				nativeDevCreated = true;
+				nativeDevNames.push_front (nativeDevName.str());
 				++nativeDevCount;
 			}
 
+			deviceMapper.WaitForDeviceNodes();
+
 			// Test whether the device mapper is able to read and decrypt the last sector
 			SecureBuffer lastSectorBuf (volume->GetSectorSize());
 			uint64 lastSectorOffset = volume->GetSize() - volume->GetSectorSize();
@@ -469,12 +788,10 @@ namespace VeraCrypt
 
 			try
 			{
-				if (nativeDevCreated)
-				{
-					make_shared_auto (VolumeInfo, vol);
-					vol->VirtualDevice = nativeDevPath;
-					DismountNativeVolume (vol);
-				}
+				foreach (const string &nativeDevName, nativeDevNames)
+					deviceMapper.RemoveDevice (nativeDevName);
+
+				deviceMapper.WaitForDeviceNodes();
 			}
 			catch (...) { }
 
@@ -489,6 +806,49 @@ namespace VeraCrypt
 		}
 	}
 
+	bool CoreLinux::SetLoopDeviceBackingFile (const File &loopDevice, const File &backingFile, const FilePath &filePath, bool readOnly, bool directIo, size_t logicalBlockSize) const
+	{
+		int loopFd = loopDevice.GetSystemHandle();
+
+		LoopConfig config;
+		Memory::Zero (&config, sizeof (config));
+		config.fd = backingFile.GetSystemHandle();
+		config.block_size = static_cast <uint32> (logicalBlockSize);
+		config.info.lo_flags = (readOnly ? LO_FLAGS_READ_ONLY : 0) | (directIo ? LO_FLAGS_DIRECT_IO : 0);
+		strncpy ((char *) config.info.lo_file_name, string (filePath).c_str(), LO_NAME_SIZE - 1);
+
+		// The device is attached and configured atomically (Linux 5.8 and later)
+		if (ioctl (loopFd, LOOP_CONFIGURE, &config) != -1)
+			return true;
+
+		if (errno == EBUSY)
+			return false;
+
+		// Older kernels do not support LOOP_CONFIGURE and may reject the block size or direct I/O, which are optimizations
+		if (ioctl (loopFd, LOOP_SET_FD, config.fd) == -1)
+		{
+			throw_sys_sub_if (errno != EBUSY, wstring (filePath));
+			return false;
+		}
+
+		config.info.lo_flags = 0;
+		if (ioctl (loopFd, LOOP_SET_STATUS64, &config.info) == -1)
+		{
+			int error = errno;
+			ioctl (loopFd, LOOP_CLR_FD, 0);
+			throw SystemException (SRC_POS, error);
+		}
+
+		if (logicalBlockSize != 0)
+			ioctl (loopFd, LOOP_SET_BLOCK_SIZE, static_cast <unsigned long> (logicalBlockSize));
+
+		// Direct I/O requires requests aligned to the block size of the backing file, which is why it is enabled last
+		if (directIo)
+			ioctl (loopFd, LOOP_SET_DIRECT_IO, 1UL);
+
+		return true;
+	}
+
 	auto_ptr <CoreBase> Core (new CoreServiceProxy <CoreLinux>);
 	auto_ptr <CoreBase> CoreDirect (new CoreLinux);
 }
@@ -27,12 +27,14 @@ namespace VeraCrypt
 		virtual HostDeviceList GetHostDevices (bool pathListOnly = false) const;
 
 	protected:
-		virtual DevicePath AttachFileToLoopDevice (const FilePath &filePath, bool readOnly) const;
+		virtual DevicePath AttachFileToLoopDevice (const FilePath &filePath, bool readOnly, bool directIo = false, size_t logicalBlockSize = 0) const;
+		void ConfigureLoopDevice (const DevicePath &loopDevice, bool directIo) const;
 		virtual void DetachLoopDevice (const DevicePath &devicePath) const;
 		virtual void DismountNativeVolume (shared_ptr <VolumeInfo> mountedVolume) const;
 		virtual MountedFilesystemList GetMountedFilesystems (const DevicePath &devicePath = DevicePath(), const DirectoryPath &mountPoint = DirectoryPath()) const;
 		virtual void MountFilesystem (const DevicePath &devicePath, const DirectoryPath &mountPoint, const string &filesystemType, bool readOnly, const string &systemMountOptions) const;
 		virtual void MountVolumeNative (shared_ptr <Volume> volume, MountOptions &options, const DirectoryPath &auxMountPoint) const;
+		bool SetLoopDeviceBackingFile (const File &loopDevice, const File &backingFile, const FilePath &filePath, bool readOnly, bool directIo, size_t logicalBlockSize) const;
 
 	private:
 		CoreLinux (const CoreLinux &);
@@ -111,7 +111,7 @@ namespace VeraCrypt
 		Process::Execute ("open", args);
 	}
 
-	void CoreMacOSX::MountAuxVolumeImage (const DirectoryPath &auxMountPoint, const MountOptions &options) const
+	void CoreMacOSX::MountAuxVolumeImage (const DirectoryPath &auxMountPoint, const MountOptions &options, size_t sectorSize) const
 	{
 		// Check FUSE version
 		char fuseVersionString[MAXHOSTNAMELEN + 1] = { 0 };
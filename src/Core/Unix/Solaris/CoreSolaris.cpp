@@ -29,7 +29,7 @@ namespace VeraCrypt
 	{
 	}
 
-	DevicePath CoreSolaris::AttachFileToLoopDevice (const FilePath &filePath, bool readOnly) const
+	DevicePath CoreSolaris::AttachFileToLoopDevice (const FilePath &filePath, bool readOnly, bool directIo, size_t logicalBlockSize) const
 	{
 		list <string> args;
 		args.push_back ("-a");
@@ -27,7 +27,7 @@ namespace VeraCrypt
 		virtual HostDeviceList GetHostDevices (bool pathListOnly = false) const;
 
 	protected:
-		virtual DevicePath AttachFileToLoopDevice (const FilePath &filePath, bool readOnly) const;
+		virtual DevicePath AttachFileToLoopDevice (const FilePath &filePath, bool readOnly, bool directIo = false, size_t logicalBlockSize = 0) const;
 		virtual void DetachLoopDevice (const DevicePath &devicePath) const;
 		virtual MountedFilesystemList GetMountedFilesystems (const DevicePath &devicePath = DevicePath(), const DirectoryPath &mountPoint = DirectoryPath()) const;
 		virtual void MountFilesystem (const DevicePath &devicePath, const DirectoryPath &mountPoint, const string &filesystemType, bool readOnly, const string &systemMountOptions) const;
@@ -0,0 +1,405 @@
+/*
+ Argon2id (RFC 9106, version 0x13) written for VeraCrypt.
+
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages.
+*/
+
+#include <memory.h>
+#include <stdlib.h>
+#include "Blake2.h"
+#include "Argon2.h"
+
+static void store32 (byte *dst, uint32 w)
+{
+	dst[0] = (byte) w;
+	dst[1] = (byte) (w >> 8);
+	dst[2] = (byte) (w >> 16);
+	dst[3] = (byte) (w >> 24);
+}
+
+static void blake2b_update32 (blake2b_state *S, uint32 w)
+{
+	byte buf[4];
+	store32 (buf, w);
+	blake2b_update (S, buf, sizeof (buf));
+}
+
+static void load_block (ARGON2_BLOCK *dst, const byte *src)
+{
+	int i, j;
+	for (i = 0; i < ARGON2_QWORDS_IN_BLOCK; ++i)
+	{
+		uint64 w = 0;
+		for (j = 7; j >= 0; --j)
+			w = (w << 8) | src[i * 8 + j];
+		dst->v[i] = w;
+	}
+}
+
+static void store_block (byte *dst, const ARGON2_BLOCK *src)
+{
+	int i, j;
+	for (i = 0; i < ARGON2_QWORDS_IN_BLOCK; ++i)
+	{
+		for (j = 0; j < 8; ++j)
+			dst[i * 8 + j] = (byte) (src->v[i] >> (8 * j));
+	}
+}
+
+/* Variable-length hash function H' */
+static void blake2b_long (byte *out, uint32 outlen, const byte *in, uint32 inlen)
+{
+	blake2b_state S;
+
+	blake2b_init (&S, outlen < BLAKE2B_OUTBYTES ? outlen : BLAKE2B_OUTBYTES);
+	blake2b_update32 (&S, outlen);
+	blake2b_update (&S, in, inlen);
+
+	if (outlen <= BLAKE2B_OUTBYTES)
+	{
+		blake2b_final (&S, out, outlen);
+	}
+	else
+	{
+		byte outBuffer[BLAKE2B_OUTBYTES];
+		byte inBuffer[BLAKE2B_OUTBYTES];
+		uint32 toProduce = outlen - BLAKE2B_OUTBYTES / 2;
+
+		blake2b_final (&S, outBuffer, BLAKE2B_OUTBYTES);
+		memcpy (out, outBuffer, BLAKE2B_OUTBYTES / 2);
+		out += BLAKE2B_OUTBYTES / 2;
+
+		while (toProduce > BLAKE2B_OUTBYTES)
+		{
+			memcpy (inBuffer, outBuffer, BLAKE2B_OUTBYTES);
+			blake2b (outBuffer, BLAKE2B_OUTBYTES, inBuffer, BLAKE2B_OUTBYTES);
+			memcpy (out, outBuffer, BLAKE2B_OUTBYTES / 2);
+			out += BLAKE2B_OUTBYTES / 2;
+			toProduce -= BLAKE2B_OUTBYTES / 2;
+		}
+
+		memcpy (inBuffer, outBuffer, BLAKE2B_OUTBYTES);
+		blake2b (out, toProduce, inBuffer, BLAKE2B_OUTBYTES);
+
+		burn (outBuffer, sizeof (outBuffer));
+		burn (inBuffer, sizeof (inBuffer));
+	}
+}
+
+#define ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+static uint64 fBlaMka (uint64 x, uint64 y)
+{
+	const uint64 m = 0xFFFFFFFFULL;
+	return x + y + 2 * ((x & m) * (y & m));
+}
+
+#define G(a, b, c, d) \
+	do { \
+		a = fBlaMka (a, b); \
+		d = ROTR64 (d ^ a, 32); \
+		c = fBlaMka (c, d); \
+		b = ROTR64 (b ^ c, 24); \
+		a = fBlaMka (a, b); \
+		d = ROTR64 (d ^ a, 16); \
+		c = fBlaMka (c, d); \
+		b = ROTR64 (b ^ c, 63); \
+	} while (0)
+
+#define BLAKE2_ROUND_NOMSG(v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15) \
+	do { \
+		G (v0, v4, v8, v12); \
+		G (v1, v5, v9, v13); \
+		G (v2, v6, v10, v14); \
+		G (v3, v7, v11, v15); \
+		G (v0, v5, v10, v15); \
+		G (v1, v6, v11, v12); \
+		G (v2, v7, v8, v13); \
+		G (v3, v4, v9, v14); \
+	} while (0)
+
+/* Compression function G applied to prevBlock and refBlock. The result is written to
+   nextBlock, or XORed into it for passes after the first one. */
+static void fill_block (const ARGON2_BLOCK *prevBlock, const ARGON2_BLOCK *refBlock, ARGON2_BLOCK *nextBlock, int withXor)
+{
+	ARGON2_BLOCK R, tmp;
+	uint64 *v = R.v;
+	int i;
+
+	for (i = 0; i < ARGON2_QWORDS_IN_BLOCK; ++i)
+	{
+		R.v[i] = refBlock->v[i] ^ prevBlock->v[i];
+		tmp.v[i] = withXor ? R.v[i] ^ nextBlock->v[i] : R.v[i];
+	}
+
+	for (i = 0; i < 8; ++i)
+	{
+		BLAKE2_ROUND_NOMSG (
+			v[16 * i], v[16 * i + 1], v[16 * i + 2], v[16 * i + 3],
+			v[16 * i + 4], v[16 * i + 5], v[16 * i + 6], v[16 * i + 7],
+			v[16 * i + 8], v[16 * i + 9], v[16 * i + 10], v[16 * i + 11],
+			v[16 * i + 12], v[16 * i + 13], v[16 * i + 14], v[16 * i + 15]);
+	}
+
+	for (i = 0; i < 8; ++i)
+	{
+		BLAKE2_ROUND_NOMSG (
+			v[2 * i], v[2 * i + 1], v[2 * i + 16], v[2 * i + 17],
+			v[2 * i + 32], v[2 * i + 33], v[2 * i + 48], v[2 * i + 49],
+			v[2 * i + 64], v[2 * i + 65], v[2 * i + 80], v[2 * i + 81],
+			v[2 * i + 96], v[2 * i + 97], v[2 * i + 112], v[2 * i + 113]);
+	}
+
+	for (i = 0; i < ARGON2_QWORDS_IN_BLOCK; ++i)
+		nextBlock->v[i] = tmp.v[i] ^ R.v[i];
+
+	burn (&R, sizeof (R));
+	burn (&tmp, sizeof (tmp));
+}
+
+static void next_addresses (ARGON2_BLOCK *addressBlock, ARGON2_BLOCK *inputBlock, const ARGON2_BLOCK *zeroBlock)
+{
+	inputBlock->v[6]++;
+	fill_block (zeroBlock, inputBlock, addressBlock, 0);
+	fill_block (zeroBlock, addressBlock, addressBlock, 0);
+}
+
+static uint32 index_alpha (const ARGON2_INSTANCE *instance, uint32 pass, uint32 slice, uint32 index, uint32 pseudoRand, int sameLane)
+{
+	uint32 referenceAreaSize;
+	uint32 startPosition = 0;
+	uint64 relativePosition;
+
+	if (pass == 0)
+	{
+		if (slice == 0)
+			referenceAreaSize = index - 1;
+		else if (sameLane)
+			referenceAreaSize = slice * instance->segment_length + index - 1;
+		else
+			referenceAreaSize = slice * instance->segment_length + (index == 0 ? -1 : 0);
+	}
+	else
+	{
+		if (sameLane)
+			referenceAreaSize = instance->lane_length - instance->segment_length + index - 1;
+		else
+			referenceAreaSize = instance->lane_length - instance->segment_length + (index == 0 ? -1 : 0);
+
+		if (slice != ARGON2_SYNC_POINTS - 1)
+			startPosition = (slice + 1) * instance->segment_length;
+	}
+
+	relativePosition = pseudoRand;
+	relativePosition = (relativePosition * relativePosition) >> 32;
+	relativePosition = referenceAreaSize - 1 - ((referenceAreaSize * relativePosition) >> 32);
+
+	return (uint32) ((startPosition + relativePosition) % instance->lane_length);
+}
+
+size_t argon2_memory_size (uint32 memoryCost, uint32 lanes)
+{
+	uint32 segmentLength;
+
+	if (lanes == 0)
+		return 0;
+
+	if (memoryCost < ARGON2_MIN_MEMORY_COST (lanes))
+		memoryCost = ARGON2_MIN_MEMORY_COST (lanes);
+
+	segmentLength = memoryCost / (lanes * ARGON2_SYNC_POINTS);
+	return (size_t) segmentLength * lanes * ARGON2_SYNC_POINTS * sizeof (ARGON2_BLOCK);
+}
+
+int argon2id_init (ARGON2_INSTANCE *instance, ARGON2_BLOCK *memory,
+	const byte *pwd, uint32 pwdlen, const byte *salt, uint32 saltlen,
+	const byte *secret, uint32 secretlen, const byte *ad, uint32 adlen,
+	uint32 timeCost, uint32 memoryCost, uint32 lanes, uint32 outlen)
+{
+	byte blockHash[ARGON2_PREHASH_SEED_LENGTH];
+	byte blockBytes[ARGON2_BLOCK_SIZE];
+	blake2b_state S;
+	uint32 memoryBlocks = memoryCost;
+	uint32 l;
+
+	if (timeCost < 1 || lanes < 1 || lanes > 0xFFFFFF || outlen < 4 || saltlen < 8)
+		return 0;
+
+	if (memoryBlocks < ARGON2_MIN_MEMORY_COST (lanes))
+		memoryBlocks = ARGON2_MIN_MEMORY_COST (lanes);
+
+	instance->memory = memory;
+	instance->passes = timeCost;
+	instance->lanes = lanes;
+	instance->segment_length = memoryBlocks / (lanes * ARGON2_SYNC_POINTS);
+	instance->lane_length = instance->segment_length * ARGON2_SYNC_POINTS;
+	instance->memory_blocks = instance->lane_length * lanes;
+
+	/* H0 */
+	blake2b_init (&S, ARGON2_PREHASH_DIGEST_LENGTH);
+	blake2b_update32 (&S, lanes);
+	blake2b_update32 (&S, outlen);
+	blake2b_update32 (&S, memoryCost);
+	blake2b_update32 (&S, timeCost);
+	blake2b_update32 (&S, ARGON2_VERSION);
+	blake2b_update32 (&S, ARGON2_TYPE_ID);
+	blake2b_update32 (&S, pwdlen);
+	blake2b_update (&S, pwd, pwdlen);
+	blake2b_update32 (&S, saltlen);
+	blake2b_update (&S, salt, saltlen);
+	blake2b_update32 (&S, secretlen);
+	blake2b_update (&S, secret, secretlen);
+	blake2b_update32 (&S, adlen);
+	blake2b_update (&S, ad, adlen);
+	blake2b_final (&S, blockHash, ARGON2_PREHASH_DIGEST_LENGTH);
+
+	/* First two blocks of each lane */
+	for (l = 0; l < lanes; ++l)
+	{
+		store32 (blockHash + ARGON2_PREHASH_DIGEST_LENGTH, 0);
+		store32 (blockHash + ARGON2_PREHASH_DIGEST_LENGTH + 4, l);
+		blake2b_long (blockBytes, ARGON2_BLOCK_SIZE, blockHash, ARGON2_PREHASH_SEED_LENGTH);
+		load_block (&memory[l * instance->lane_length], blockBytes);
+
+		store32 (blockHash + ARGON2_PREHASH_DIGEST_LENGTH, 1);
+		blake2b_long (blockBytes, ARGON2_BLOCK_SIZE, blockHash, ARGON2_PREHASH_SEED_LENGTH);
+		load_block (&memory[l * instance->lane_length + 1], blockBytes);
+	}
+
+	burn (blockHash, sizeof (blockHash));
+	burn (blockBytes, sizeof (blockBytes));
+	return 1;
+}
+
+void argon2id_fill_segment (const ARGON2_INSTANCE *instance, uint32 pass, uint32 lane, uint32 slice)
+{
+	ARGON2_BLOCK addressBlock, inputBlock, zeroBlock;
+	int dataIndependent = (pass == 0 && slice < ARGON2_SYNC_POINTS / 2);
+	uint32 startingIndex = 0;
+	uint32 currOffset, prevOffset;
+	uint32 i;
+
+	if (dataIndependent)
+	{
+		memset (&zeroBlock, 0, sizeof (zeroBlock));
+		memset (&inputBlock, 0, sizeof (inputBlock));
+		inputBlock.v[0] = pass;
+		inputBlock.v[1] = lane;
+		inputBlock.v[2] = slice;
+		inputBlock.v[3] = instance->memory_blocks;
+		inputBlock.v[4] = instance->passes;
+		inputBlock.v[5] = ARGON2_TYPE_ID;
+	}
+
+	if (pass == 0 && slice == 0)
+	{
+		/* The first two blocks were generated by argon2id_init() */
+		startingIndex = 2;
+
+		if (dataIndependent)
+			next_addresses (&addressBlock, &inputBlock, &zeroBlock);
+	}
+
+	currOffset = lane * instance->lane_length + slice * instance->segment_length + startingIndex;
+	prevOffset = (currOffset % instance->lane_length == 0) ? currOffset + instance->lane_length - 1 : currOffset - 1;
+
+	for (i = startingIndex; i < instance->segment_length; ++i, ++currOffset, ++prevOffset)
+	{
+		uint64 pseudoRand;
+		uint32 refLane, refIndex;
+
+		if (currOffset % instance->lane_length == 1)
+			prevOffset = currOffset - 1;
+
+		if (dataIndependent)
+		{
+			if (i % ARGON2_QWORDS_IN_BLOCK == 0)
+				next_addresses (&addressBlock, &inputBlock, &zeroBlock);
+
+			pseudoRand = addressBlock.v[i % ARGON2_QWORDS_IN_BLOCK];
+		}
+		else
+		{
+			pseudoRand = instance->memory[prevOffset].v[0];
+		}
+
+		refLane = (uint32) ((pseudoRand >> 32) % instance->lanes);
+		if (pass == 0 && slice == 0)
+			refLane = lane;
+
+		refIndex = index_alpha (instance, pass, slice, i, (uint32) (pseudoRand & 0xFFFFFFFF), refLane == lane);
+
+		fill_block (&instance->memory[prevOffset],
+			&instance->memory[(size_t) instance->lane_length * refLane + refIndex],
+			&instance->memory[currOffset], pass != 0);
+	}
+
+	if (dataIndependent)
+	{
+		burn (&addressBlock, sizeof (addressBlock));
+		burn (&inputBlock, sizeof (inputBlock));
+	}
+}
+
+void argon2id_finalize (const ARGON2_INSTANCE *instance, byte *out, uint32 outlen)
+{
+	ARGON2_BLOCK blockHash;
+	byte blockBytes[ARGON2_BLOCK_SIZE];
+	uint32 l;
+	int i;
+
+	blockHash = instance->memory[instance->lane_length - 1];
+
+	for (l = 1; l < instance->lanes; ++l)
+	{
+		const ARGON2_BLOCK *lastBlock = &instance->memory[l * instance->lane_length + instance->lane_length - 1];
+		for (i = 0; i < ARGON2_QWORDS_IN_BLOCK; ++i)
+			blockHash.v[i] ^= lastBlock->v[i];
+	}
+
+	store_block (blockBytes, &blockHash);
+	blake2b_long (out, outlen, blockBytes, ARGON2_BLOCK_SIZE);
+
+	burn (&blockHash, sizeof (blockHash));
+	burn (blockBytes, sizeof (blockBytes));
+}
+
+int argon2id_hash (const byte *pwd, uint32 pwdlen, const byte *salt, uint32 saltlen,
+	const byte *secret, uint32 secretlen, const byte *ad, uint32 adlen,
+	uint32 timeCost, uint32 memoryCost, uint32 lanes, byte *out, uint32 outlen)
+{
+	ARGON2_INSTANCE instance;
+	ARGON2_BLOCK *memory;
+	size_t memorySize = argon2_memory_size (memoryCost, lanes);
+	uint32 pass, slice, lane;
+
+	if (memorySize == 0)
+		return 0;
+
+	memory = (ARGON2_BLOCK *) malloc (memorySize);
+	if (!memory)
+		return 0;
+
+	if (!argon2id_init (&instance, memory, pwd, pwdlen, salt, saltlen, secret, secretlen, ad, adlen, timeCost, memoryCost, lanes, outlen))
+	{
+		free (memory);
+		return 0;
+	}
+
+	for (pass = 0; pass < instance.passes; ++pass)
+	{
+		for (slice = 0; slice < ARGON2_SYNC_POINTS; ++slice)
+		{
+			for (lane = 0; lane < instance.lanes; ++lane)
+				argon2id_fill_segment (&instance, pass, lane, slice);
+		}
+	}
+
+	argon2id_finalize (&instance, out, outlen);
+
+	burn (memory, memorySize);
+	free (memory);
+	return 1;
+}
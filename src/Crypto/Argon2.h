@@ -0,0 +1,66 @@
+/*
+ Argon2id (RFC 9106, version 0x13) written for VeraCrypt.
+
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages.
+*/
+
+#ifndef ARGON2_H
+#define ARGON2_H
+
+#include "Common/Tcdefs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARGON2_VERSION			0x13
+#define ARGON2_TYPE_ID			2
+#define ARGON2_BLOCK_SIZE		1024
+#define ARGON2_QWORDS_IN_BLOCK	(ARGON2_BLOCK_SIZE / 8)
+#define ARGON2_SYNC_POINTS		4
+#define ARGON2_PREHASH_DIGEST_LENGTH	64
+#define ARGON2_PREHASH_SEED_LENGTH	(ARGON2_PREHASH_DIGEST_LENGTH + 8)
+#define ARGON2_MIN_MEMORY_COST(lanes)	(2 * ARGON2_SYNC_POINTS * (lanes))
+
+typedef struct
+{
+	uint64 v[ARGON2_QWORDS_IN_BLOCK];
+} ARGON2_BLOCK;
+
+typedef struct
+{
+	ARGON2_BLOCK *memory;
+	uint32 passes;
+	uint32 memory_blocks;
+	uint32 segment_length;
+	uint32 lane_length;
+	uint32 lanes;
+} ARGON2_INSTANCE;
+
+/* Number of bytes of block memory required for the given memory cost (KiB) and lane count */
+size_t argon2_memory_size (uint32 memoryCost, uint32 lanes);
+
+/* Initializes the instance and the first two blocks of every lane. The memory must be
+   argon2_memory_size() bytes long. Returns zero if the parameters are invalid. */
+int argon2id_init (ARGON2_INSTANCE *instance, ARGON2_BLOCK *memory,
+	const byte *pwd, uint32 pwdlen, const byte *salt, uint32 saltlen,
+	const byte *secret, uint32 secretlen, const byte *ad, uint32 adlen,
+	uint32 timeCost, uint32 memoryCost, uint32 lanes, uint32 outlen);
+
+/* Segments of one slice of a pass are independent of each other and may be filled concurrently */
+void argon2id_fill_segment (const ARGON2_INSTANCE *instance, uint32 pass, uint32 lane, uint32 slice);
+
+void argon2id_finalize (const ARGON2_INSTANCE *instance, byte *out, uint32 outlen);
+
+/* Single-threaded convenience wrapper. Returns zero if the parameters are invalid or memory cannot be allocated. */
+int argon2id_hash (const byte *pwd, uint32 pwdlen, const byte *salt, uint32 saltlen,
+	const byte *secret, uint32 secretlen, const byte *ad, uint32 adlen,
+	uint32 timeCost, uint32 memoryCost, uint32 lanes, byte *out, uint32 outlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ARGON2_H
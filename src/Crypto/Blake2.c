@@ -0,0 +1,173 @@
+/*
+ BLAKE2b (RFC 7693) written for VeraCrypt.
+
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages.
+*/
+
+#include <memory.h>
+#include "Blake2.h"
+
+static const uint64 blake2b_IV[8] =
+{
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const byte blake2b_sigma[12][16] =
+{
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+#define ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+#define G(r, i, a, b, c, d) \
+	do { \
+		a = a + b + m[blake2b_sigma[r][2 * i]]; \
+		d = ROTR64 (d ^ a, 32); \
+		c = c + d; \
+		b = ROTR64 (b ^ c, 24); \
+		a = a + b + m[blake2b_sigma[r][2 * i + 1]]; \
+		d = ROTR64 (d ^ a, 16); \
+		c = c + d; \
+		b = ROTR64 (b ^ c, 63); \
+	} while (0)
+
+static uint64 load64 (const byte *src)
+{
+	return ((uint64) src[0]) | ((uint64) src[1] << 8) | ((uint64) src[2] << 16) | ((uint64) src[3] << 24)
+		| ((uint64) src[4] << 32) | ((uint64) src[5] << 40) | ((uint64) src[6] << 48) | ((uint64) src[7] << 56);
+}
+
+static void blake2b_compress (blake2b_state *S, const byte *block)
+{
+	uint64 m[16];
+	uint64 v[16];
+	int i, r;
+
+	for (i = 0; i < 16; ++i)
+		m[i] = load64 (block + i * sizeof (m[i]));
+
+	for (i = 0; i < 8; ++i)
+		v[i] = S->h[i];
+
+	v[8] = blake2b_IV[0];
+	v[9] = blake2b_IV[1];
+	v[10] = blake2b_IV[2];
+	v[11] = blake2b_IV[3];
+	v[12] = blake2b_IV[4] ^ S->t[0];
+	v[13] = blake2b_IV[5] ^ S->t[1];
+	v[14] = blake2b_IV[6] ^ S->f[0];
+	v[15] = blake2b_IV[7] ^ S->f[1];
+
+	for (r = 0; r < 12; ++r)
+	{
+		G (r, 0, v[0], v[4], v[8], v[12]);
+		G (r, 1, v[1], v[5], v[9], v[13]);
+		G (r, 2, v[2], v[6], v[10], v[14]);
+		G (r, 3, v[3], v[7], v[11], v[15]);
+		G (r, 4, v[0], v[5], v[10], v[15]);
+		G (r, 5, v[1], v[6], v[11], v[12]);
+		G (r, 6, v[2], v[7], v[8], v[13]);
+		G (r, 7, v[3], v[4], v[9], v[14]);
+	}
+
+	for (i = 0; i < 8; ++i)
+		S->h[i] ^= v[i] ^ v[i + 8];
+
+	burn (m, sizeof (m));
+	burn (v, sizeof (v));
+}
+
+static void blake2b_increment_counter (blake2b_state *S, uint64 inc)
+{
+	S->t[0] += inc;
+	S->t[1] += (S->t[0] < inc);
+}
+
+void blake2b_init (blake2b_state *S, size_t outlen)
+{
+	int i;
+
+	memset (S, 0, sizeof (*S));
+
+	for (i = 0; i < 8; ++i)
+		S->h[i] = blake2b_IV[i];
+
+	/* Parameter block: digest length, no key, fanout 1, depth 1 */
+	S->h[0] ^= 0x01010000ULL ^ (uint64) outlen;
+	S->outlen = outlen;
+}
+
+void blake2b_update (blake2b_state *S, const void *in, size_t inlen)
+{
+	const byte *pin = (const byte *) in;
+
+	while (inlen > 0)
+	{
+		size_t fill = BLAKE2B_BLOCKBYTES - S->buflen;
+
+		/* The last block is compressed by blake2b_final() */
+		if (inlen > fill)
+		{
+			memcpy (S->buf + S->buflen, pin, fill);
+			blake2b_increment_counter (S, BLAKE2B_BLOCKBYTES);
+			blake2b_compress (S, S->buf);
+			S->buflen = 0;
+			pin += fill;
+			inlen -= fill;
+		}
+		else
+		{
+			memcpy (S->buf + S->buflen, pin, inlen);
+			S->buflen += inlen;
+			inlen = 0;
+		}
+	}
+}
+
+void blake2b_final (blake2b_state *S, void *out, size_t outlen)
+{
+	byte buffer[BLAKE2B_OUTBYTES];
+	size_t i;
+
+	blake2b_increment_counter (S, S->buflen);
+	S->f[0] = (uint64) -1;
+	memset (S->buf + S->buflen, 0, BLAKE2B_BLOCKBYTES - S->buflen);
+	blake2b_compress (S, S->buf);
+
+	for (i = 0; i < 8; ++i)
+	{
+		uint64 h = S->h[i];
+		int j;
+
+		for (j = 0; j < 8; ++j)
+			buffer[i * 8 + j] = (byte) (h >> (8 * j));
+	}
+
+	memcpy (out, buffer, outlen < S->outlen ? outlen : S->outlen);
+
+	burn (buffer, sizeof (buffer));
+	burn (S, sizeof (*S));
+}
+
+void blake2b (void *out, size_t outlen, const void *in, size_t inlen)
+{
+	blake2b_state S;
+
+	blake2b_init (&S, outlen);
+	blake2b_update (&S, in, inlen);
+	blake2b_final (&S, out, outlen);
+}
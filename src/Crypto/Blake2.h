@@ -0,0 +1,40 @@
+/*
+ BLAKE2b (RFC 7693) written for VeraCrypt.
+
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages.
+*/
+
+#ifndef BLAKE2_H
+#define BLAKE2_H
+
+#include "Common/Tcdefs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLAKE2B_BLOCKBYTES	128
+#define BLAKE2B_OUTBYTES	64
+
+typedef struct
+{
+	uint64 h[8];
+	uint64 t[2];
+	uint64 f[2];
+	byte buf[BLAKE2B_BLOCKBYTES];
+	size_t buflen;
+	size_t outlen;
+} blake2b_state;
+
+void blake2b_init (blake2b_state *S, size_t outlen);
+void blake2b_update (blake2b_state *S, const void *in, size_t inlen);
+void blake2b_final (blake2b_state *S, void *out, size_t outlen);
+void blake2b (void *out, size_t outlen, const void *in, size_t inlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLAKE2_H
@@ -10,6 +10,10 @@ and released into public domain.
 #include "Crypto/cpu.h"
 #include "Crypto/misc.h"
 
+#if CRYPTOPP_BOOL_SHANI_INTRINSICS_AVAILABLE && !defined(_UEFI)
+#include <immintrin.h>
+#endif
+
 #ifdef _UEFI
 #define NO_OPTIMIZED_VERSIONS
 #endif
@@ -756,6 +760,95 @@ void Sha256AsmTransform(sha256_ctx* ctx, void* mp, uint_64t num_blks)
 }
 #endif
 
+#if CRYPTOPP_BOOL_SHANI_INTRINSICS_AVAILABLE
+
+/* SHA extensions (SHA-NI) version, based on the public domain code by Sean Gulley and Jeffrey Walton.
+ * The state is kept in the ABEF/CDGH layout expected by sha256rnds2 for the whole run of blocks.
+ */
+
+#if defined(__GNUC__) && !defined(__SHA__)
+#define SHANI_TARGET __attribute__((target("sha,sse4.1")))
+#else
+#define SHANI_TARGET
+#endif
+
+/* four rounds using the message words in M */
+#define SHANI_ROUNDS(k, M) \
+	MSG = _mm_add_epi32(M, _mm_load_si128((const __m128i*) &SHA256_K[4 * (k)])); \
+	STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG); \
+	MSG = _mm_shuffle_epi32(MSG, 0x0E); \
+	STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG)
+
+/* load and byte-swap message words 4k..4k+3, then run four rounds */
+#define SHANI_LOAD_ROUNDS(k, M) \
+	M = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + 16 * (k))), MASK); \
+	SHANI_ROUNDS(k, M)
+
+/* W[4k..4k+3] computed in place of W[4k-16..4k-13] (M0) from W[4k-12..] (M1), W[4k-8..] (M2) and W[4k-4..] (M3) */
+#define SHANI_SCHEDULE_ROUNDS(k, M0, M1, M2, M3) \
+	M0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(M0, M1), _mm_alignr_epi8(M3, M2, 4)), M3); \
+	SHANI_ROUNDS(k, M0)
+
+static SHANI_TARGET void ShaNiSha256Transform(sha256_ctx* ctx, void* mp, uint_64t num_blks)
+{
+	const uint_8t* data = (const uint_8t*) mp;
+	const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i STATE0, STATE1, MSG, TMP;
+	__m128i MSG0, MSG1, MSG2, MSG3;
+	__m128i ABEF_SAVE, CDGH_SAVE;
+
+	TMP = _mm_loadu_si128((const __m128i*) &ctx->hash[0]);
+	STATE1 = _mm_loadu_si128((const __m128i*) &ctx->hash[4]);
+
+	TMP = _mm_shuffle_epi32(TMP, 0xB1);				/* CDAB */
+	STATE1 = _mm_shuffle_epi32(STATE1, 0x1B);		/* EFGH */
+	STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);		/* ABEF */
+	STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0);	/* CDGH */
+
+	while (num_blks--)
+	{
+		ABEF_SAVE = STATE0;
+		CDGH_SAVE = STATE1;
+
+		SHANI_LOAD_ROUNDS(0, MSG0);
+		SHANI_LOAD_ROUNDS(1, MSG1);
+		SHANI_LOAD_ROUNDS(2, MSG2);
+		SHANI_LOAD_ROUNDS(3, MSG3);
+
+		SHANI_SCHEDULE_ROUNDS(4, MSG0, MSG1, MSG2, MSG3);
+		SHANI_SCHEDULE_ROUNDS(5, MSG1, MSG2, MSG3, MSG0);
+		SHANI_SCHEDULE_ROUNDS(6, MSG2, MSG3, MSG0, MSG1);
+		SHANI_SCHEDULE_ROUNDS(7, MSG3, MSG0, MSG1, MSG2);
+		SHANI_SCHEDULE_ROUNDS(8, MSG0, MSG1, MSG2, MSG3);
+		SHANI_SCHEDULE_ROUNDS(9, MSG1, MSG2, MSG3, MSG0);
+		SHANI_SCHEDULE_ROUNDS(10, MSG2, MSG3, MSG0, MSG1);
+		SHANI_SCHEDULE_ROUNDS(11, MSG3, MSG0, MSG1, MSG2);
+		SHANI_SCHEDULE_ROUNDS(12, MSG0, MSG1, MSG2, MSG3);
+		SHANI_SCHEDULE_ROUNDS(13, MSG1, MSG2, MSG3, MSG0);
+		SHANI_SCHEDULE_ROUNDS(14, MSG2, MSG3, MSG0, MSG1);
+		SHANI_SCHEDULE_ROUNDS(15, MSG3, MSG0, MSG1, MSG2);
+
+		STATE0 = _mm_add_epi32(STATE0, ABEF_SAVE);
+		STATE1 = _mm_add_epi32(STATE1, CDGH_SAVE);
+
+		data += 64;
+	}
+
+	TMP = _mm_shuffle_epi32(STATE0, 0x1B);			/* FEBA */
+	STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);		/* DCHG */
+	STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0);	/* DCBA */
+	STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);		/* ABEF */
+
+	_mm_storeu_si128((__m128i*) &ctx->hash[0], STATE0);
+	_mm_storeu_si128((__m128i*) &ctx->hash[4], STATE1);
+}
+
+#undef SHANI_SCHEDULE_ROUNDS
+#undef SHANI_LOAD_ROUNDS
+#undef SHANI_ROUNDS
+
+#endif
+
 #endif
 
 void sha256_begin(sha256_ctx* ctx)
@@ -774,6 +867,11 @@ void sha256_begin(sha256_ctx* ctx)
 	if (!sha256transfunc)
 	{
 #ifndef NO_OPTIMIZED_VERSIONS
+#if CRYPTOPP_BOOL_SHANI_INTRINSICS_AVAILABLE
+		if (HasSHA256())
+			sha256transfunc = ShaNiSha256Transform;
+		else
+#endif
 #ifdef _M_X64
 		if (g_isIntel && HasSAVX2() && HasSBMI2())
 			sha256transfunc = Avx2Sha256Transform;
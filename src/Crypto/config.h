@@ -137,6 +137,14 @@
     #define CRYPTOPP_BOOL_SSE41_INTRINSICS_AVAILABLE 0
 #endif
 
+// SHA extensions intrinsics are compiled through a function-level target attribute on GCC/Clang,
+// so they don't require -msha to be passed globally
+#if !defined(CRYPTOPP_DISABLE_SHANI) && !defined(TC_WINDOWS_DRIVER) && !defined(_UEFI) && CRYPTOPP_BOOL_SSE2_INTRINSICS_AVAILABLE && (CRYPTOPP_GCC_VERSION >= 40900 || _MSC_VER >= 1900 || CRYPTOPP_LLVM_CLANG_VERSION >= 30400 || CRYPTOPP_APPLE_CLANG_VERSION >= 50100 || defined(__SHA__))
+    #define CRYPTOPP_BOOL_SHANI_INTRINSICS_AVAILABLE 1
+#else
+    #define CRYPTOPP_BOOL_SHANI_INTRINSICS_AVAILABLE 0
+#endif
+
 // how to allocate 16-byte aligned memory (for SSE2)
 #if defined(_MSC_VER)
 	#define CRYPTOPP_MM_MALLOC_AVAILABLE
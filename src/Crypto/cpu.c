@@ -203,6 +203,7 @@ static uint64 xgetbv()
 volatile int g_x86DetectionDone = 0;
 volatile int g_hasISSE = 0, g_hasSSE2 = 0, g_hasSSSE3 = 0, g_hasMMX = 0, g_hasAESNI = 0, g_hasCLMUL = 0, g_isP4 = 0;
 volatile int g_hasAVX = 0, g_hasAVX2 = 0, g_hasBMI2 = 0, g_hasSSE42 = 0, g_hasSSE41 = 0, g_isIntel = 0, g_isAMD = 0;
+volatile int g_hasSHA = 0;
 volatile uint32 g_cacheLineSize = CRYPTOPP_L1_CACHE_LINE_SIZE;
 
 VC_INLINE int IsIntel(const uint32 output[4])
@@ -318,6 +319,14 @@ void DetectX86Features()
 	g_hasAESNI = g_hasSSE2 && (cpuid1[2] & (1<<25));
 	g_hasCLMUL = g_hasSSE2 && (cpuid1[2] & (1<<1));
 
+	/* SHA extensions: bit 29 of EBX of CPUID leaf 0x7 (sub-leaf 0) */
+	if (g_hasSSE41 && g_hasSSSE3 && cpuid[0] >= 7)
+	{
+		uint32 cpuid7[4] = {0};
+		if (CpuId(7, cpuid7))
+			g_hasSHA = (cpuid7[1] & (1 << 29)) != 0;
+	}
+
 #if !defined (_UEFI) && ((defined(__AES__) && defined(__PCLMUL__)) || defined(__INTEL_COMPILER) || CRYPTOPP_BOOL_AESNI_INTRINSICS_AVAILABLE)
 	// Hypervisor = bit 31 of ECX of CPUID leaf 0x1
 	// reference: http://artemonsecurity.com/vmde.pdf
@@ -397,6 +406,7 @@ void DisableCPUExtendedFeatures ()
 	g_hasSSSE3 = 0;
 	g_hasAESNI = 0;
 	g_hasCLMUL = 0;
+	g_hasSHA = 0;
 }
 
 #endif
@@ -198,6 +198,7 @@ extern volatile int g_hasSSE41;
 extern volatile int g_hasSSSE3;
 extern volatile int g_hasAESNI;
 extern volatile int g_hasCLMUL;
+extern volatile int g_hasSHA;
 extern volatile int g_isP4;
 extern volatile int g_isIntel;
 extern volatile int g_isAMD;
@@ -219,6 +220,7 @@ void DisableCPUExtendedFeatures ();
 #define HasSSSE3() g_hasSSSE3
 #define HasAESNI() g_hasAESNI
 #define HasCLMUL() g_hasCLMUL
+#define HasSHA256() g_hasSHA
 #define IsP4() g_isP4
 #define IsCpuIntel() g_isIntel
 #define IsCpuAMD() g_isAMD
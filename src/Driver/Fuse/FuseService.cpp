@@ -10,12 +10,17 @@
  code distribution packages.
 */
 
-#define FUSE_USE_VERSION  25
+#ifdef TC_MACOSX
+#	define FUSE_USE_VERSION  26	// osxfuse implements the FUSE 2.9 low-level API
+#else
+#	define FUSE_USE_VERSION  32
+#endif
 #include <errno.h>
 #include <fcntl.h>
-#include <fuse.h>
+#include <fuse_lowlevel.h>
 #include <iostream>
 #include <signal.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -36,22 +41,138 @@
 
 namespace VeraCrypt
 {
-	static int fuse_service_access (const char *path, int mask)
+	// Requests are dispatched by inode number; the file system has a fixed set of three nodes
+	struct FuseServiceInode
+	{
+		enum Enum
+		{
+			Root = FUSE_ROOT_ID,
+			VolumeImage,
+			Control
+		};
+	};
+
+	static const double FuseServiceAttributeTimeout = 1.0;
+
+	// Cached decrypted data is invalidated when buffered writes reach the volume
+	struct FuseServiceWriteBackHandler
+	{
+		void OnSectorsWritten (EventArgs &args)
+		{
+			VolumeSectorsWrittenEventArgs &written = dynamic_cast <VolumeSectorsWrittenEventArgs &> (args);
+			FuseService::InvalidateCachedSectors (written.ByteOffset, written.Size);
+		}
+	};
+
+	static FuseServiceWriteBackHandler WriteBackHandler;
+
+	// Buffer borrowed from the request buffer pool until the request completes
+	struct FuseServiceRequestBuffer
+	{
+		FuseServiceRequestBuffer () { }
+		~FuseServiceRequestBuffer ()
+		{
+			if (Data)
+				FuseService::ReleaseRequestBuffer (Data);
+		}
+
+		BufferPtr Get (size_t size)
+		{
+			if (!Data)
+				Data = FuseService::AcquireRequestBuffer (size);
+
+			return Data->GetRange (0, size);
+		}
+
+	protected:
+		shared_ptr <Buffer> Data;
+
+	private:
+		FuseServiceRequestBuffer (const FuseServiceRequestBuffer &);
+		FuseServiceRequestBuffer &operator= (const FuseServiceRequestBuffer &);
+	};
+
+	static bool fuse_service_check_access (fuse_req_t req)
+	{
+		return FuseService::CheckAccessRights (fuse_req_ctx (req)->uid);
+	}
+
+	// Returns the data of a write request as one contiguous buffer. Data received into memory is
+	// returned where it lies; data spliced from /dev/fuse into a pipe is copied into the request buffer.
+	static BufferPtr fuse_service_get_write_data (struct fuse_bufvec *bufv, FuseServiceRequestBuffer &requestBuffer)
+	{
+		size_t size = fuse_buf_size (bufv);
+
+		if (bufv->count == 1 && bufv->idx == 0 && !(bufv->buf[0].flags & FUSE_BUF_IS_FD))
+			return BufferPtr ((byte *) bufv->buf[0].mem + bufv->off, size);
+
+		BufferPtr data = requestBuffer.Get (size);
+		struct fuse_bufvec dataBufVec = FUSE_BUFVEC_INIT (size);
+		dataBufVec.buf[0].mem = data.Get();
+
+		ssize_t copied = fuse_buf_copy (&dataBufVec, bufv, (fuse_buf_copy_flags) 0);
+		if (copied < 0)
+			throw SystemException (SRC_POS, -copied);
+
+		if ((size_t) copied != size)
+			throw SystemException (SRC_POS, EIO);
+
+		return data;
+	}
+
+	static int fuse_service_stat (fuse_req_t req, fuse_ino_t ino, struct stat *statData)
+	{
+		Memory::Zero (statData, sizeof(*statData));
+
+		statData->st_ino = ino;
+		statData->st_uid = FuseService::GetUserId();
+		statData->st_gid = FuseService::GetGroupId();
+		statData->st_atime = time (NULL);
+		statData->st_ctime = time (NULL);
+		statData->st_mtime = time (NULL);
+
+		if (ino == FuseServiceInode::Root)
+		{
+			statData->st_mode = S_IFDIR | 0500;
+			statData->st_nlink = 2;
+			return 0;
+		}
+
+		if (!fuse_service_check_access (req))
+			return EACCES;
+
+		switch (ino)
+		{
+		case FuseServiceInode::VolumeImage:
+			statData->st_mode = S_IFREG | 0600;
+			statData->st_nlink = 1;
+			statData->st_size = FuseService::GetVolumeSize();
+			return 0;
+
+		case FuseServiceInode::Control:
+			statData->st_mode = S_IFREG | 0600;
+			statData->st_nlink = 1;
+			statData->st_size = FuseService::GetVolumeInfo()->Size();
+			return 0;
+
+		default:
+			return ENOENT;
+		}
+	}
+
+	static void fuse_service_access (fuse_req_t req, fuse_ino_t ino, int mask)
 	{
 		try
 		{
-			if (!FuseService::CheckAccessRights())
-				return -EACCES;
+			fuse_reply_err (req, fuse_service_check_access (req) ? 0 : EACCES);
 		}
 		catch (...)
 		{
-			return FuseService::ExceptionToErrorCode();
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
 		}
-
-		return 0;
 	}
 
-	static void *fuse_service_init ()
+	static void fuse_service_init (void *userdata, struct fuse_conn_info *conn)
 	{
 		try
 		{
@@ -64,8 +185,13 @@ namespace VeraCrypt
 			sigaction (SIGQUIT, &action, nullptr);
 			sigaction (SIGTERM, &action, nullptr);
 
+			// Large requests let sequential I/O reach the encryption thread pool in chunks it can split
+			conn->max_write = FuseService::GetMaxRequestSize();
+
 			if (!EncryptionThreadPool::IsRunning())
 				EncryptionThreadPool::Start();
+
+			FuseService::StartBackgroundThreads();
 		}
 		catch (exception &e)
 		{
@@ -75,8 +201,6 @@ namespace VeraCrypt
 		{
 			SystemLog::WriteException (UnknownException (SRC_POS));
 		}
-
-		return nullptr;
 	}
 
 	static void fuse_service_destroy (void *userdata)
@@ -95,230 +219,402 @@ namespace VeraCrypt
 		}
 	}
 
-	static int fuse_service_getattr (const char *path, struct stat *statData)
+#ifdef FALLOC_FL_PUNCH_HOLE
+	static void fuse_service_fallocate (fuse_req_t req, fuse_ino_t ino, int mode, off_t offset, off_t length, struct fuse_file_info *fi)
 	{
 		try
 		{
-			Memory::Zero (statData, sizeof(*statData));
-
-			statData->st_uid = FuseService::GetUserId();
-			statData->st_gid = FuseService::GetGroupId();
-			statData->st_atime = time (NULL);
-			statData->st_ctime = time (NULL);
-			statData->st_mtime = time (NULL);
-
-			if (strcmp (path, "/") == 0)
+			if (!fuse_service_check_access (req))
 			{
-				statData->st_mode = S_IFDIR | 0500;
-				statData->st_nlink = 2;
+				fuse_reply_err (req, EACCES);
+				return;
 			}
-			else
-			{
-				if (!FuseService::CheckAccessRights())
-					return -EACCES;
 
-				if (strcmp (path, FuseService::GetVolumeImagePath()) == 0)
-				{
-					statData->st_mode = S_IFREG | 0600;
-					statData->st_nlink = 1;
-					statData->st_size = FuseService::GetVolumeSize();
-				}
-				else if (strcmp (path, FuseService::GetControlPath()) == 0)
-				{
-					statData->st_mode = S_IFREG | 0600;
-					statData->st_nlink = 1;
-					statData->st_size = FuseService::GetVolumeInfo()->Size();
-				}
-				else
-				{
-					return -ENOENT;
-				}
+			// The size of the volume image is fixed; only discards of its sectors are supported
+			if (ino != FuseServiceInode::VolumeImage
+				|| mode != (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE)
+				|| !FuseService::AreDiscardsAllowed())
+			{
+				fuse_reply_err (req, EOPNOTSUPP);
+				return;
 			}
+
+			FuseService::DiscardVolumeSectors (offset, length);
+			fuse_reply_err (req, 0);
 		}
 		catch (...)
 		{
-			return FuseService::ExceptionToErrorCode();
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
 		}
+	}
+#endif
+
+	static void fuse_service_flush (fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi)
+	{
+		try
+		{
+			if (ino == FuseServiceInode::VolumeImage)
+				FuseService::FlushVolume (false);
 
-		return 0;
+			fuse_reply_err (req, 0);
+		}
+		catch (...)
+		{
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
+		}
 	}
 
-	static int fuse_service_opendir (const char *path, struct fuse_file_info *fi)
+	static void fuse_service_fsync (fuse_req_t req, fuse_ino_t ino, int datasync, struct fuse_file_info *fi)
 	{
 		try
 		{
-			if (!FuseService::CheckAccessRights())
-				return -EACCES;
+			if (ino == FuseServiceInode::VolumeImage)
+				FuseService::FlushVolume (true);
 
-			if (strcmp (path, "/") != 0)
-				return -ENOENT;
+			fuse_reply_err (req, 0);
 		}
 		catch (...)
 		{
-			return FuseService::ExceptionToErrorCode();
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
 		}
+	}
+
+	static void fuse_service_getattr (fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi)
+	{
+		try
+		{
+			struct stat statData;
+			int error = fuse_service_stat (req, ino, &statData);
 
-		return 0;
+			if (error != 0)
+				fuse_reply_err (req, error);
+			else
+				fuse_reply_attr (req, &statData, FuseServiceAttributeTimeout);
+		}
+		catch (...)
+		{
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
+		}
 	}
 
-	static int fuse_service_open (const char *path, struct fuse_file_info *fi)
+	static void fuse_service_lookup (fuse_req_t req, fuse_ino_t parent, const char *name)
 	{
 		try
 		{
-			if (!FuseService::CheckAccessRights())
-				return -EACCES;
+			if (!fuse_service_check_access (req))
+			{
+				fuse_reply_err (req, EACCES);
+				return;
+			}
+
+			struct fuse_entry_param entry;
+			Memory::Zero (&entry, sizeof (entry));
 
-			if (strcmp (path, FuseService::GetVolumeImagePath()) == 0)
-				return 0;
+			if (parent != FuseServiceInode::Root)
+			{
+				fuse_reply_err (req, ENOENT);
+				return;
+			}
+
+			if (strcmp (name, FuseService::GetVolumeImagePath() + 1) == 0)
+				entry.ino = FuseServiceInode::VolumeImage;
+			else if (strcmp (name, FuseService::GetControlPath() + 1) == 0)
+				entry.ino = FuseServiceInode::Control;
+			else
+			{
+				fuse_reply_err (req, ENOENT);
+				return;
+			}
+
+			int error = fuse_service_stat (req, entry.ino, &entry.attr);
+			if (error != 0)
+			{
+				fuse_reply_err (req, error);
+				return;
+			}
+
+			entry.attr_timeout = FuseServiceAttributeTimeout;
+			entry.entry_timeout = FuseServiceAttributeTimeout;
+			fuse_reply_entry (req, &entry);
+		}
+		catch (...)
+		{
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
+		}
+	}
+
+	static void fuse_service_opendir (fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi)
+	{
+		try
+		{
+			if (!fuse_service_check_access (req))
+				fuse_reply_err (req, EACCES);
+			else if (ino != FuseServiceInode::Root)
+				fuse_reply_err (req, ENOENT);
+			else
+				fuse_reply_open (req, fi);
+		}
+		catch (...)
+		{
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
+		}
+	}
+
+	static void fuse_service_open (fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi)
+	{
+		try
+		{
+			if (!fuse_service_check_access (req))
+			{
+				fuse_reply_err (req, EACCES);
+				return;
+			}
 
-			if (strcmp (path, FuseService::GetControlPath()) == 0)
+			switch (ino)
 			{
+			case FuseServiceInode::VolumeImage:
+				fuse_reply_open (req, fi);
+				return;
+
+			case FuseServiceInode::Control:
 				fi->direct_io = 1;
-				return 0;
+
+				// Reads of one open file return the same snapshot even if the volume information changes
+				if ((fi->flags & O_ACCMODE) != O_WRONLY)
+					fi->fh = reinterpret_cast <uint64_t> (new shared_ptr <Buffer> (FuseService::GetVolumeInfo()));
+
+				fuse_reply_open (req, fi);
+				return;
+
+			default:
+				fuse_reply_err (req, ENOENT);
+				return;
 			}
 		}
 		catch (...)
 		{
-			return FuseService::ExceptionToErrorCode();
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
 		}
-		return -ENOENT;
 	}
 
-	static int fuse_service_read (const char *path, char *buf, size_t size, off_t offset, struct fuse_file_info *fi)
+	static void fuse_service_read (fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *fi)
 	{
 		try
 		{
-			if (!FuseService::CheckAccessRights())
-				return -EACCES;
+			if (!fuse_service_check_access (req))
+			{
+				fuse_reply_err (req, EACCES);
+				return;
+			}
 
-			if (strcmp (path, FuseService::GetVolumeImagePath()) == 0)
+			if (ino == FuseServiceInode::VolumeImage)
 			{
 				try
 				{
 					// Test for read beyond the end of the volume
-					if ((uint64) offset + size > FuseService::GetVolumeSize())
+					if ((uint64) offset >= FuseService::GetVolumeSize())
+						size = 0;
+					else if ((uint64) offset + size > FuseService::GetVolumeSize())
 						size = FuseService::GetVolumeSize() - offset;
 
-					size_t sectorSize = FuseService::GetVolumeSectorSize();
-					if (size % sectorSize != 0 || offset % sectorSize != 0)
+					if (size == 0)
 					{
-						// Support for non-sector-aligned read operations is required by some loop device tools
-						// which may analyze the volume image before attaching it as a device
+						fuse_reply_buf (req, nullptr, 0);
+						return;
+					}
 
-						uint64 alignedOffset = offset - (offset % sectorSize);
-						uint64 alignedSize = size + (offset % sectorSize);
+					// Support for non-sector-aligned read operations is required by some loop device tools
+					// which may analyze the volume image before attaching it as a device
+					size_t sectorSize = FuseService::GetVolumeSectorSize();
+					uint64 alignedOffset = offset - (offset % sectorSize);
+					uint64 alignedSize = size + (offset % sectorSize);
 
-						if (alignedSize % sectorSize != 0)
-							alignedSize += sectorSize - (alignedSize % sectorSize);
+					if (alignedSize % sectorSize != 0)
+						alignedSize += sectorSize - (alignedSize % sectorSize);
 
-						SecureBuffer alignedBuffer (alignedSize);
+					// Sectors are decrypted in place in a pooled buffer and copied once to the kernel
+					FuseServiceRequestBuffer requestBuffer;
+					BufferPtr alignedBuffer = requestBuffer.Get (alignedSize);
 
-						FuseService::ReadVolumeSectors (alignedBuffer, alignedOffset);
-						BufferPtr ((byte *) buf, size).CopyFrom (alignedBuffer.GetRange (offset % sectorSize, size));
-					}
-					else
-					{
-						FuseService::ReadVolumeSectors (BufferPtr ((byte *) buf, size), offset);
-					}
+					FuseService::ReadVolumeSectors (alignedBuffer, alignedOffset);
+					fuse_reply_buf (req, (const char *) alignedBuffer.Get() + (offset % sectorSize), size);
 				}
 				catch (MissingVolumeData)
 				{
-					return 0;
+					fuse_reply_buf (req, nullptr, 0);
 				}
 
-				return size;
+				return;
 			}
 
-			if (strcmp (path, FuseService::GetControlPath()) == 0)
+			if (ino == FuseServiceInode::Control)
 			{
-				shared_ptr <Buffer> infoBuf = FuseService::GetVolumeInfo();
-				BufferPtr outBuf ((byte *)buf, size);
+				shared_ptr <Buffer> infoBuf = fi->fh ? *reinterpret_cast <shared_ptr <Buffer> *> (fi->fh) : FuseService::GetVolumeInfo();
 
 				if (offset >= (off_t) infoBuf->Size())
-					return 0;
+				{
+					fuse_reply_buf (req, nullptr, 0);
+					return;
+				}
 
 				if (offset + size > infoBuf->Size())
 					size = infoBuf->Size () - offset;
 
-				outBuf.CopyFrom (infoBuf->GetRange (offset, size));
-				return size;
+				fuse_reply_buf (req, (const char *) infoBuf->Ptr() + offset, size);
+				return;
 			}
+
+			fuse_reply_err (req, ENOENT);
 		}
 		catch (...)
 		{
-			return FuseService::ExceptionToErrorCode();
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
 		}
+	}
 
-		return -ENOENT;
+	static void fuse_service_release (fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi)
+	{
+		if (ino == FuseServiceInode::Control && fi->fh)
+			delete reinterpret_cast <shared_ptr <Buffer> *> (fi->fh);
+
+		fuse_reply_err (req, 0);
 	}
 
-	static int fuse_service_readdir (const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi)
+	static void fuse_service_readdir (fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *fi)
 	{
 		try
 		{
-			if (!FuseService::CheckAccessRights())
-				return -EACCES;
+			if (!fuse_service_check_access (req))
+			{
+				fuse_reply_err (req, EACCES);
+				return;
+			}
+
+			if (ino != FuseServiceInode::Root)
+			{
+				fuse_reply_err (req, ENOENT);
+				return;
+			}
+
+			struct DirectoryEntry
+			{
+				const char *Name;
+				fuse_ino_t Inode;
+				mode_t Mode;
+			};
+
+			const DirectoryEntry entries[] =
+			{
+				{ ".", FuseServiceInode::Root, S_IFDIR },
+				{ "..", FuseServiceInode::Root, S_IFDIR },
+				{ FuseService::GetVolumeImagePath() + 1, FuseServiceInode::VolumeImage, S_IFREG },
+				{ FuseService::GetControlPath() + 1, FuseServiceInode::Control, S_IFREG }
+			};
+
+			const size_t entryCount = array_capacity (entries);
+			Buffer dirBuffer (size);
+			size_t dirSize = 0;
+
+			// The offset of each entry is the index of the next one
+			for (size_t i = (size_t) offset; i < entryCount; ++i)
+			{
+				struct stat statData;
+				Memory::Zero (&statData, sizeof (statData));
+				statData.st_ino = entries[i].Inode;
+				statData.st_mode = entries[i].Mode;
 
-			if (strcmp (path, "/") != 0)
-				return -ENOENT;
+				size_t entrySize = fuse_add_direntry (req, (char *) dirBuffer.Ptr() + dirSize, size - dirSize, entries[i].Name, &statData, i + 1);
+				if (entrySize > size - dirSize)
+					break;
+
+				dirSize += entrySize;
+			}
 
-			filler (buf, ".", NULL, 0);
-			filler (buf, "..", NULL, 0);
-			filler (buf, FuseService::GetVolumeImagePath() + 1, NULL, 0);
-			filler (buf, FuseService::GetControlPath() + 1, NULL, 0);
+			fuse_reply_buf (req, (const char *) dirBuffer.Ptr(), dirSize);
 		}
 		catch (...)
 		{
-			return FuseService::ExceptionToErrorCode();
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
 		}
-
-		return 0;
 	}
 
-	static int fuse_service_write (const char *path, const char *buf, size_t size, off_t offset, struct fuse_file_info *fi)
+	static void fuse_service_write_buf (fuse_req_t req, fuse_ino_t ino, struct fuse_bufvec *bufv, off_t offset, struct fuse_file_info *fi)
 	{
+		size_t size = fuse_buf_size (bufv);
+
 		try
 		{
-			if (!FuseService::CheckAccessRights())
-				return -EACCES;
+			if (!fuse_service_check_access (req))
+			{
+				fuse_reply_err (req, EACCES);
+				return;
+			}
 
-			if (strcmp (path, FuseService::GetVolumeImagePath()) == 0)
+			FuseServiceRequestBuffer requestBuffer;
+
+			if (ino == FuseServiceInode::VolumeImage)
 			{
-				FuseService::WriteVolumeSectors (BufferPtr ((byte *) buf, size), offset);
-				return size;
+				// Sectors are encrypted in place, which overwrites the plaintext of the request
+				FuseService::WriteVolumeSectors (fuse_service_get_write_data (bufv, requestBuffer), offset);
+				fuse_reply_write (req, size);
+				return;
 			}
 
-			if (strcmp (path, FuseService::GetControlPath()) == 0)
+			if (ino == FuseServiceInode::Control)
 			{
 				if (FuseService::AuxDeviceInfoReceived())
-					return -EACCES;
+				{
+					fuse_reply_err (req, EACCES);
+					return;
+				}
 
-				FuseService::ReceiveAuxDeviceInfo (ConstBufferPtr ((const byte *)buf, size));
-				return size;
+				FuseService::ReceiveAuxDeviceInfo (fuse_service_get_write_data (bufv, requestBuffer));
+				fuse_reply_write (req, size);
+				return;
 			}
+
+			fuse_reply_err (req, ENOENT);
 		}
 #ifdef TC_FREEBSD
 		// FreeBSD apparently retries failed write operations forever, which may lead to a system crash.
 		catch (VolumeReadOnly&)
 		{
-			return size;
+			fuse_reply_write (req, size);
 		}
 		catch (VolumeProtected&)
 		{
-			return size;
+			fuse_reply_write (req, size);
 		}
 #endif
 		catch (...)
 		{
-			return FuseService::ExceptionToErrorCode();
+			fuse_reply_err (req, -FuseService::ExceptionToErrorCode());
 		}
+	}
 
-		return -ENOENT;
+	shared_ptr <Buffer> FuseService::AcquireRequestBuffer (size_t size)
+	{
+		// Requests larger than negotiated are served by a buffer that is not returned to the pool
+		if (size > GetRequestBufferSize())
+			return shared_ptr <Buffer> (new SecureBuffer (size, Volume::DirectIoAlignment));
+
+		{
+			ScopeLock lock (RequestBufferPoolMutex);
+
+			if (!RequestBufferPool.empty())
+			{
+				shared_ptr <Buffer> buffer = RequestBufferPool.front();
+				RequestBufferPool.pop_front();
+				return buffer;
+			}
+		}
+
+		return shared_ptr <Buffer> (new SecureBuffer (GetRequestBufferSize(), Volume::DirectIoAlignment));
 	}
 
-	bool FuseService::CheckAccessRights ()
+	bool FuseService::CheckAccessRights (uid_t requestUserId)
 	{
-		return fuse_get_context()->uid == 0 || fuse_get_context()->uid == UserId;
+		return requestUserId == 0 || requestUserId == UserId;
 	}
 
 	void FuseService::CloseMountedVolume ()
@@ -338,12 +634,76 @@ namespace VeraCrypt
 
 	void FuseService::Dismount ()
 	{
+		// Buffered writes are completed before cached data is released
+		WriteBack.reset();
+		ReadAhead.reset();
+
+		if (SectorCache.get())
+			SectorCache->Clear();
+
 		CloseMountedVolume();
 
+		{
+			ScopeLock lock (RequestBufferPoolMutex);
+			RequestBufferPool.clear();
+		}
+
 		if (EncryptionThreadPool::IsRunning())
 			EncryptionThreadPool::Stop();
 	}
 
+	void FuseService::DiscardVolumeSectors (uint64 byteOffset, uint64 size)
+	{
+		if (!MountedVolume)
+			throw NotInitialized (SRC_POS);
+
+		uint64 sectorSize = MountedVolume->GetSectorSize();
+		uint64 endOfRange = min (byteOffset + size, MountedVolume->GetSize());
+
+		if (endOfRange <= byteOffset)
+			return;
+
+		// Discarded ranges must read as zeros; parts of sectors are overwritten with zeros
+		uint64 startOffset = (byteOffset + sectorSize - 1) / sectorSize * sectorSize;
+		uint64 endOffset = endOfRange / sectorSize * sectorSize;
+
+		if (byteOffset < startOffset)
+			ZeroVolumeSectorRange (byteOffset, min (startOffset, endOfRange) - byteOffset);
+
+		if (endOfRange > endOffset && endOffset >= startOffset)
+			ZeroVolumeSectorRange (endOffset, endOfRange - endOffset);
+
+		if (endOffset <= startOffset)
+			return;
+
+		// Buffered writes to the range must not reach the host after the range has been discarded
+		if (WriteBack.get())
+			WriteBack->Flush (false);
+
+		try
+		{
+			MountedVolume->DiscardSectors (startOffset, endOffset - startOffset);
+		}
+		catch (...)
+		{
+			InvalidateCachedSectors (startOffset, endOffset - startOffset);
+			throw;
+		}
+
+		InvalidateCachedSectors (startOffset, endOffset - startOffset);
+	}
+
+	void FuseService::FlushVolume (bool flushHostFile)
+	{
+		if (!MountedVolume)
+			throw NotInitialized (SRC_POS);
+
+		if (WriteBack.get())
+			WriteBack->Flush (flushHostFile);
+		else if (flushHostFile)
+			MountedVolume->GetFile()->Flush();
+	}
+
 	int FuseService::ExceptionToErrorCode ()
 	{
 		try
@@ -367,6 +727,10 @@ namespace VeraCrypt
 		{
 			return -EPERM;
 		}
+		catch (NotImplemented&)
+		{
+			return -EOPNOTSUPP;
+		}
 		catch (SystemException &e)
 		{
 			SystemLog::WriteException (e);
@@ -386,22 +750,54 @@ namespace VeraCrypt
 
 	shared_ptr <Buffer> FuseService::GetVolumeInfo ()
 	{
-		shared_ptr <Stream> stream (new MemoryStream);
+		ScopeLock lock (OpenVolumeInfoMutex);
 
+		// The serialized information is rebuilt only when its counters change, and at most once per
+		// update interval while I/O is in progress. Triggered hidden volume protection is reported at once.
+		if (VolumeInfoCache)
 		{
-			ScopeLock lock (OpenVolumeInfoMutex);
+			if (OpenVolumeInfo.HiddenVolumeProtectionTriggered != MountedVolume->IsHiddenVolumeProtectionTriggered())
+				VolumeInfoCache.reset();
+			else if (OpenVolumeInfo.TotalDataRead == MountedVolume->GetTotalDataRead()
+				&& OpenVolumeInfo.TotalDataWritten == MountedVolume->GetTotalDataWritten()
+				&& OpenVolumeInfo.TopWriteOffset == MountedVolume->GetTopWriteOffset()
+				&& OpenVolumeInfo.Statistics.GetCount (VolumeStatistics::Operation::ReadRequest) == MountedVolume->GetStatistics().GetCount (VolumeStatistics::Operation::ReadRequest)
+				&& OpenVolumeInfo.Statistics.GetCount (VolumeStatistics::Operation::WriteRequest) == MountedVolume->GetStatistics().GetCount (VolumeStatistics::Operation::WriteRequest)
+				&& (!SectorCache.get() || (OpenVolumeInfo.SectorCacheHits == SectorCache->GetHitCount()
+					&& OpenVolumeInfo.SectorCacheMisses == SectorCache->GetMissCount())))
+			{
+				return VolumeInfoCache;
+			}
+			else if (GetMonotonicTime() - VolumeInfoCacheTime < VolumeInfoUpdateInterval)
+				return VolumeInfoCache;
+		}
 
-			OpenVolumeInfo.Set (*MountedVolume);
-			OpenVolumeInfo.SlotNumber = SlotNumber;
+		OpenVolumeInfo.Set (*MountedVolume);
+		OpenVolumeInfo.SlotNumber = SlotNumber;
 
-			OpenVolumeInfo.Serialize (stream);
+		if (SectorCache.get())
+		{
+			OpenVolumeInfo.SectorCacheHits = SectorCache->GetHitCount();
+			OpenVolumeInfo.SectorCacheMisses = SectorCache->GetMissCount();
 		}
 
+		shared_ptr <Stream> stream (new MemoryStream);
+		OpenVolumeInfo.Serialize (stream);
+
+		// A new buffer is created as snapshots of open control files may still refer to the previous one
 		ConstBufferPtr infoBuf = dynamic_cast <MemoryStream&> (*stream);
-		shared_ptr <Buffer> outBuf (new Buffer (infoBuf.Size()));
-		outBuf->CopyFrom (infoBuf);
+		VolumeInfoCache.reset (new Buffer (infoBuf));
+		VolumeInfoCacheTime = GetMonotonicTime();
 
-		return outBuf;
+		return VolumeInfoCache;
+	}
+
+	uint64 FuseService::GetMonotonicTime ()
+	{
+		struct timespec now;
+		throw_sys_if (clock_gettime (CLOCK_MONOTONIC, &now) == -1);
+
+		return static_cast <uint64> (now.tv_sec) * 1000 + now.tv_nsec / 1000000;
 	}
 
 	const char *FuseService::GetVolumeImagePath ()
@@ -421,7 +817,7 @@ namespace VeraCrypt
 		return MountedVolume->GetSize();
 	}
 
-	void FuseService::Mount (shared_ptr <Volume> openVolume, VolumeSlotNumber slotNumber, const string &fuseMountPoint)
+	void FuseService::Mount (shared_ptr <Volume> openVolume, VolumeSlotNumber slotNumber, const string &fuseMountPoint, uint64 sectorCacheSize, uint64 readAheadSize, uint64 writeBackSize, bool allowDiscards)
 	{
 		list <string> args;
 		args.push_back (FuseService::GetDeviceType());
@@ -440,7 +836,12 @@ namespace VeraCrypt
 			args.push_back ("allow_other");
 		}
 
-		ExecFunctor execFunctor (openVolume, slotNumber);
+#ifndef TC_MACOSX
+		args.push_back ("-o");
+		args.push_back ("max_read=" + StringConverter::ToSingle (static_cast <uint64> (GetMaxRequestSize())));
+#endif
+
+		ExecFunctor execFunctor (openVolume, slotNumber, sectorCacheSize, readAheadSize, writeBackSize, allowDiscards);
 		Process::Execute ("fuse", args, -1, &execFunctor);
 
 		for (int t = 0; true; t++)
@@ -465,7 +866,25 @@ namespace VeraCrypt
 		if (!MountedVolume)
 			throw NotInitialized (SRC_POS);
 
-		MountedVolume->ReadSectors (buffer, byteOffset);
+		uint64 startTime = VolumeStatistics::GetTime();
+
+		// Buffered writes are captured before the volume is read as they may be written meanwhile
+		VolumeWriteBack::PendingWriteList pendingWrites;
+		if (WriteBack.get())
+			WriteBack->GetPendingWrites (byteOffset, buffer.Size(), pendingWrites);
+
+		if (!ReadAhead.get() || !ReadAhead->ReadSectors (buffer, byteOffset))
+		{
+			if (SectorCache.get())
+				SectorCache->ReadSectors (*MountedVolume, buffer, byteOffset);
+			else
+				MountedVolume->ReadSectors (buffer, byteOffset);
+		}
+
+		if (!pendingWrites.empty())
+			VolumeWriteBack::ApplyPendingWrites (pendingWrites, buffer, byteOffset);
+
+		MountedVolume->GetStatistics().Add (VolumeStatistics::Operation::ReadRequest, buffer.Size(), VolumeStatistics::GetTime() - startTime);
 	}
 
 	void FuseService::ReceiveAuxDeviceInfo (const ConstBufferPtr &buffer)
@@ -476,6 +895,114 @@ namespace VeraCrypt
 		ScopeLock lock (OpenVolumeInfoMutex);
 		OpenVolumeInfo.VirtualDevice = sr.DeserializeString ("VirtualDevice");
 		OpenVolumeInfo.LoopDevice = sr.DeserializeString ("LoopDevice");
+		VolumeInfoCache.reset();
+	}
+
+	void FuseService::InvalidateCachedSectors (uint64 byteOffset, uint64 size)
+	{
+		if (ReadAhead.get())
+			ReadAhead->Invalidate (byteOffset, size);
+
+		if (SectorCache.get())
+			SectorCache->Invalidate (byteOffset, size);
+	}
+
+	int FuseService::RunSession (int argc, char *argv[], const struct fuse_lowlevel_ops *operations, size_t operationsSize)
+	{
+		struct fuse_args args = FUSE_ARGS_INIT (argc, argv);
+		int status = 1;
+
+#ifdef TC_MACOSX
+		char *mountPoint = nullptr;
+		int multiThreaded;
+		int foreground;
+
+		if (fuse_parse_cmdline (&args, &mountPoint, &multiThreaded, &foreground) != 0 || !mountPoint)
+		{
+			fuse_opt_free_args (&args);
+			return 1;
+		}
+
+		struct fuse_chan *channel = fuse_mount (mountPoint, &args);
+
+		if (channel)
+		{
+			struct fuse_session *session = fuse_lowlevel_new (&args, operations, operationsSize, nullptr);
+
+			if (session)
+			{
+				fuse_session_add_chan (session, channel);
+
+				if (fuse_daemonize (foreground) == 0 && fuse_set_signal_handlers (session) == 0)
+				{
+					status = multiThreaded ? fuse_session_loop_mt (session) : fuse_session_loop (session);
+					fuse_remove_signal_handlers (session);
+				}
+
+				fuse_session_remove_chan (channel);
+				fuse_session_destroy (session);
+			}
+
+			fuse_unmount (mountPoint, channel);
+		}
+
+		free (mountPoint);
+#else
+		struct fuse_cmdline_opts options;
+
+		if (fuse_parse_cmdline (&args, &options) != 0 || !options.mountpoint)
+		{
+			fuse_opt_free_args (&args);
+			return 1;
+		}
+
+		struct fuse_session *session = fuse_session_new (&args, operations, operationsSize, nullptr);
+
+		if (session)
+		{
+			if (fuse_session_mount (session, options.mountpoint) == 0)
+			{
+				if (fuse_daemonize (options.foreground) == 0 && fuse_set_signal_handlers (session) == 0)
+				{
+					// Each worker reads from its own cloned /dev/fuse channel (FUSE_DEV_IOC_CLONE), and idle
+					// workers are kept so that their channels survive bursts. libfuse falls back to the shared
+					// descriptor on kernels that cannot clone it.
+					struct fuse_loop_config loopConfig;
+					loopConfig.clone_fd = 1;
+					loopConfig.max_idle_threads = options.max_idle_threads;
+
+					size_t cpuCount = EncryptionThreadPool::GetCpuCount();
+					if (loopConfig.max_idle_threads < cpuCount)
+						loopConfig.max_idle_threads = (unsigned int) cpuCount;
+
+					status = options.singlethread ? fuse_session_loop (session) : fuse_session_loop_mt (session, &loopConfig);
+					fuse_remove_signal_handlers (session);
+				}
+
+				fuse_session_unmount (session);
+			}
+
+			fuse_session_destroy (session);
+		}
+
+		free (options.mountpoint);
+#endif
+		fuse_opt_free_args (&args);
+
+		return status != 0 ? 1 : 0;
+	}
+
+	void FuseService::ReleaseRequestBuffer (shared_ptr <Buffer> buffer)
+	{
+		if (buffer->Size() != GetRequestBufferSize())
+			return;
+
+		try
+		{
+			ScopeLock lock (RequestBufferPoolMutex);
+			RequestBufferPool.push_front (buffer);
+		}
+		catch (...) { }
 	}
 
 	void FuseService::SendAuxDeviceInfo (const DirectoryPath &fuseMountPoint, const DevicePath &virtualDevice, const DevicePath &loopDevice)
@@ -491,12 +1018,60 @@ namespace VeraCrypt
 		fuseServiceControl.Write (dynamic_cast <MemoryStream&> (*stream));
 	}
 
-	void FuseService::WriteVolumeSectors (const ConstBufferPtr &buffer, uint64 byteOffset)
+	void FuseService::StartBackgroundThreads ()
+	{
+		if (!MountedVolume)
+			return;
+
+		if (ReadAheadSize > 0 && !ReadAhead.get())
+			ReadAhead.reset (new VolumeReadAhead (*MountedVolume, ReadAheadSize));
+
+		if (WriteBackSize > 0 && !WriteBack.get())
+		{
+			WriteBack.reset (new VolumeWriteBack (*MountedVolume, WriteBackSize));
+			WriteBack->SectorsWrittenEvent.Connect (EventConnector <FuseServiceWriteBackHandler> (&WriteBackHandler, &FuseServiceWriteBackHandler::OnSectorsWritten));
+		}
+	}
+
+	void FuseService::WriteVolumeSectors (const BufferPtr &buffer, uint64 byteOffset)
 	{
 		if (!MountedVolume)
 			throw NotInitialized (SRC_POS);
 
-		MountedVolume->WriteSectors (buffer, byteOffset);
+		uint64 startTime = VolumeStatistics::GetTime();
+
+		if (WriteBack.get())
+		{
+			WriteBack->Write (buffer, byteOffset);
+			MountedVolume->GetStatistics().Add (VolumeStatistics::Operation::WriteRequest, buffer.Size(), VolumeStatistics::GetTime() - startTime);
+			return;
+		}
+
+		try
+		{
+			MountedVolume->WriteSectorsInPlace (buffer, byteOffset);
+		}
+		catch (...)
+		{
+			// Part of the data may have been written
+			InvalidateCachedSectors (byteOffset, buffer.Size());
+			throw;
+		}
+
+		InvalidateCachedSectors (byteOffset, buffer.Size());
+		MountedVolume->GetStatistics().Add (VolumeStatistics::Operation::WriteRequest, buffer.Size(), VolumeStatistics::GetTime() - startTime);
+	}
+
+	void FuseService::ZeroVolumeSectorRange (uint64 byteOffset, uint64 size)
+	{
+		uint64 sectorSize = MountedVolume->GetSectorSize();
+		uint64 sectorOffset = byteOffset / sectorSize * sectorSize;
+
+		SecureBuffer sector ((size_t) sectorSize);
+		ReadVolumeSectors (sector, sectorOffset);
+
+		sector.GetRange ((size_t) (byteOffset - sectorOffset), (size_t) size).Zero();
+		WriteVolumeSectors (sector, sectorOffset);
 	}
 
 	void FuseService::OnSignal (int signal)
@@ -519,9 +1094,20 @@ namespace VeraCrypt
 		gettimeofday (&tv, NULL);
 		FuseService::OpenVolumeInfo.SerialInstanceNumber = (uint64)tv.tv_sec * 1000000ULL + tv.tv_usec;
 
+		FuseService::AllowDiscards = AllowDiscards;
 		FuseService::MountedVolume = MountedVolume;
 		FuseService::SlotNumber = SlotNumber;
 
+		if (AllowDiscards)
+			MountedVolume->EnableDiscards();
+
+		if (SectorCacheSize > 0)
+			FuseService::SectorCache.reset (new VolumeSectorCache (SectorCacheSize));
+
+		// Background threads are started when the session is initialized in the daemonized process
+		FuseService::ReadAheadSize = ReadAheadSize;
+		FuseService::WriteBackSize = WriteBackSize;
+
 		FuseService::UserId = getuid();
 		FuseService::GroupId = getgid();
 
@@ -541,17 +1127,24 @@ namespace VeraCrypt
 			catch (...) { }
 		}
 
-		static fuse_operations fuse_service_oper;
+		static fuse_lowlevel_ops fuse_service_oper;
 
 		fuse_service_oper.access = fuse_service_access;
 		fuse_service_oper.destroy = fuse_service_destroy;
+#ifdef FALLOC_FL_PUNCH_HOLE
+		fuse_service_oper.fallocate = fuse_service_fallocate;
+#endif
+		fuse_service_oper.flush = fuse_service_flush;
+		fuse_service_oper.fsync = fuse_service_fsync;
 		fuse_service_oper.getattr = fuse_service_getattr;
 		fuse_service_oper.init = fuse_service_init;
+		fuse_service_oper.lookup = fuse_service_lookup;
 		fuse_service_oper.open = fuse_service_open;
 		fuse_service_oper.opendir = fuse_service_opendir;
 		fuse_service_oper.read = fuse_service_read;
 		fuse_service_oper.readdir = fuse_service_readdir;
-		fuse_service_oper.write = fuse_service_write;
+		fuse_service_oper.release = fuse_service_release;
+		fuse_service_oper.write_buf = fuse_service_write_buf;
 
 		// Create a new session
 		setsid ();
@@ -583,14 +1176,24 @@ namespace VeraCrypt
 
 		SignalHandlerPipe->GetWriteFD();
 
-		_exit (fuse_main (argc, argv, &fuse_service_oper));
+		_exit (RunSession (argc, argv, &fuse_service_oper, sizeof (fuse_service_oper)));
 	}
 
+	bool FuseService::AllowDiscards;
 	VolumeInfo FuseService::OpenVolumeInfo;
 	Mutex FuseService::OpenVolumeInfoMutex;
 	shared_ptr <Volume> FuseService::MountedVolume;
 	VolumeSlotNumber FuseService::SlotNumber;
 	uid_t FuseService::UserId;
 	gid_t FuseService::GroupId;
+	auto_ptr <VolumeReadAhead> FuseService::ReadAhead;
+	uint64 FuseService::ReadAheadSize;
+	list < shared_ptr <Buffer> > FuseService::RequestBufferPool;
+	Mutex FuseService::RequestBufferPoolMutex;
+	auto_ptr <VolumeSectorCache> FuseService::SectorCache;
+	auto_ptr <VolumeWriteBack> FuseService::WriteBack;
+	uint64 FuseService::WriteBackSize;
+	shared_ptr <Buffer> FuseService::VolumeInfoCache;
+	uint64 FuseService::VolumeInfoCacheTime;
 	auto_ptr <Pipe> FuseService::SignalHandlerPipe;
 }
@@ -18,6 +18,11 @@
 #include "Platform/Unix/Process.h"
 #include "Volume/VolumeInfo.h"
 #include "Volume/Volume.h"
+#include "Volume/VolumeReadAhead.h"
+#include "Volume/VolumeSectorCache.h"
+#include "Volume/VolumeWriteBack.h"
+
+struct fuse_lowlevel_ops;
 
 namespace VeraCrypt
 {
@@ -27,47 +32,74 @@ namespace VeraCrypt
 	protected:
 		struct ExecFunctor : public ProcessExecFunctor
 		{
-			ExecFunctor (shared_ptr <Volume> openVolume, VolumeSlotNumber slotNumber)
-				: MountedVolume (openVolume), SlotNumber (slotNumber)
+			ExecFunctor (shared_ptr <Volume> openVolume, VolumeSlotNumber slotNumber, uint64 sectorCacheSize, uint64 readAheadSize, uint64 writeBackSize, bool allowDiscards)
+				: AllowDiscards (allowDiscards), MountedVolume (openVolume), ReadAheadSize (readAheadSize), SectorCacheSize (sectorCacheSize), SlotNumber (slotNumber), WriteBackSize (writeBackSize)
 			{
 			}
 			virtual void operator() (int argc, char *argv[]);
 
 		protected:
+			bool AllowDiscards;
 			shared_ptr <Volume> MountedVolume;
+			uint64 ReadAheadSize;
+			uint64 SectorCacheSize;
 			VolumeSlotNumber SlotNumber;
+			uint64 WriteBackSize;
 		};
 
 		friend class ExecFunctor;
 
 	public:
+		static shared_ptr <Buffer> AcquireRequestBuffer (size_t size);
+		static bool AreDiscardsAllowed () { return AllowDiscards; }
 		static bool AuxDeviceInfoReceived () { return !OpenVolumeInfo.VirtualDevice.IsEmpty(); }
-		static bool CheckAccessRights ();
+		static bool CheckAccessRights (uid_t requestUserId);
+		static void DiscardVolumeSectors (uint64 byteOffset, uint64 size);
 		static void Dismount ();
 		static int ExceptionToErrorCode ();
+		static void FlushVolume (bool flushHostFile);
 		static const char *GetControlPath () { return "/control"; }
 		static const char *GetVolumeImagePath ();
 		static string GetDeviceType () { return "veracrypt"; }
 		static uid_t GetGroupId () { return GroupId; }
+		static size_t GetMaxRequestSize () { return 1024 * 1024; }
 		static uid_t GetUserId () { return UserId; }
 		static shared_ptr <Buffer> GetVolumeInfo ();
 		static uint64 GetVolumeSize ();
 		static uint64 GetVolumeSectorSize () { return MountedVolume->GetSectorSize(); }
-		static void Mount (shared_ptr <Volume> openVolume, VolumeSlotNumber slotNumber, const string &fuseMountPoint);
+		static void InvalidateCachedSectors (uint64 byteOffset, uint64 size);
+		static void Mount (shared_ptr <Volume> openVolume, VolumeSlotNumber slotNumber, const string &fuseMountPoint, uint64 sectorCacheSize = 0, uint64 readAheadSize = 0, uint64 writeBackSize = 0, bool allowDiscards = false);
 		static void ReadVolumeSectors (const BufferPtr &buffer, uint64 byteOffset);
 		static void ReceiveAuxDeviceInfo (const ConstBufferPtr &buffer);
+		static void ReleaseRequestBuffer (shared_ptr <Buffer> buffer);
 		static void SendAuxDeviceInfo (const DirectoryPath &fuseMountPoint, const DevicePath &virtualDevice, const DevicePath &loopDevice = DevicePath());
-		static void WriteVolumeSectors (const ConstBufferPtr &buffer, uint64 byteOffset);
+		static void StartBackgroundThreads ();
+		static void WriteVolumeSectors (const BufferPtr &buffer, uint64 byteOffset); // Encrypts the contents of buffer
 
 	protected:
 		FuseService ();
 		static void CloseMountedVolume ();
+		static uint64 GetMonotonicTime (); // Milliseconds
+		static size_t GetRequestBufferSize () { return GetMaxRequestSize() + 2 * TC_MAX_VOLUME_SECTOR_SIZE; } // Room for sector alignment of unaligned reads
 		static void OnSignal (int signal);
+		static int RunSession (int argc, char *argv[], const struct fuse_lowlevel_ops *operations, size_t operationsSize);
+		static void ZeroVolumeSectorRange (uint64 byteOffset, uint64 size); // The range must lie within one sector
 
+		static bool AllowDiscards;
 		static VolumeInfo OpenVolumeInfo;
 		static Mutex OpenVolumeInfoMutex;
 		static shared_ptr <Volume> MountedVolume;
+		static auto_ptr <VolumeReadAhead> ReadAhead;
+		static uint64 ReadAheadSize;
+		static list < shared_ptr <Buffer> > RequestBufferPool;
+		static Mutex RequestBufferPoolMutex;
+		static auto_ptr <VolumeSectorCache> SectorCache;
+		static auto_ptr <VolumeWriteBack> WriteBack;
+		static uint64 WriteBackSize;
 		static VolumeSlotNumber SlotNumber;
+		static shared_ptr <Buffer> VolumeInfoCache;
+		static uint64 VolumeInfoCacheTime;
+		static const uint64 VolumeInfoUpdateInterval = 500; // Milliseconds
 		static uid_t UserId;
 		static gid_t GroupId;
 		static auto_ptr <Pipe> SignalHandlerPipe;
@@ -18,10 +18,12 @@
 #include "CommandLineInterface.h"
 #include "LanguageStrings.h"
 #include "UserInterfaceException.h"
+#include "Xml.h"
 
 namespace VeraCrypt
 {
 	CommandLineInterface::CommandLineInterface (int argc, wchar_t** argv, UserInterfaceType::Enum interfaceType) :
+		ArgCalibrationTime (0),
 		ArgCommand (CommandId::None),
 		ArgFilesystem (VolumeCreationOptions::FilesystemType::Unknown),
 		ArgNewPim (-1),
@@ -43,7 +45,9 @@ namespace VeraCrypt
 #ifdef TC_WINDOWS
 		parser.AddSwitch (L"",  L"cache",				_("Cache passwords and keyfiles"));
 #endif
+		parser.AddOption (L"",  L"calibrate-pim",		_("Calibrate PIM for a target key derivation time"));
 		parser.AddSwitch (L"C", L"change",				_("Change password or keyfiles"));
+		parser.AddOption (L"",	L"change-batch",		_("Change passwords or keyfiles of volumes listed in a file"));
 		parser.AddSwitch (L"c", L"create",				_("Create new volume"));
 		parser.AddSwitch (L"",	L"create-keyfile",		_("Create new keyfile"));
 		parser.AddSwitch (L"",	L"delete-token-keyfiles", _("Delete security token keyfiles"));
@@ -85,6 +89,7 @@ namespace VeraCrypt
 		parser.AddSwitch (L"",	L"quick",				_("Enable quick format"));
 		parser.AddOption (L"",	L"size",				_("Size in bytes"));
 		parser.AddOption (L"",	L"slot",				_("Volume slot number"));
+		parser.AddSwitch (L"",	L"stats",				_("Display volume I/O statistics"));
 		parser.AddSwitch (L"tc",L"truecrypt",			_("Enable TrueCrypt mode. Should be put first to avoid issues."));
 		parser.AddSwitch (L"",	L"test",				_("Test internal algorithms"));
 		parser.AddSwitch (L"t", L"text",				_("Use text user interface"));
@@ -98,6 +103,7 @@ namespace VeraCrypt
 		parser.AddParam (								_("Mount point"), wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL);
 
 		wxString str;
+		wxString passwordChangeManifest;
 		bool param1IsVolume = false;
 		bool param1IsMountedVolumeSpec = false;
 		bool param1IsMountPoint = false;
@@ -173,6 +179,24 @@ namespace VeraCrypt
 			param1IsVolume = true;
 		}
 
+		if (parser.Found (L"calibrate-pim", &str))
+		{
+			CheckCommandSingle();
+			ArgCommand = CommandId::CalibrateKdf;
+
+			try
+			{
+				ArgCalibrationTime = StringConverter::ToUInt32 (wstring (str));
+			}
+			catch (...)
+			{
+				throw_err (LangString["PARAMETER_INCORRECT"] + L": " + str);
+			}
+
+			if (ArgCalibrationTime < 1)
+				throw_err (LangString["PARAMETER_INCORRECT"] + L": " + str);
+		}
+
 		if (parser.Found (L"change"))
 		{
 			CheckCommandSingle();
@@ -180,6 +204,12 @@ namespace VeraCrypt
 			param1IsVolume = true;
 		}
 
+		if (parser.Found (L"change-batch", &passwordChangeManifest))
+		{
+			CheckCommandSingle();
+			ArgCommand = CommandId::ChangePasswordBatch;
+		}
+
 		if (parser.Found (L"create"))
 		{
 			CheckCommandSingle();
@@ -245,6 +275,13 @@ namespace VeraCrypt
 			ArgCommand = CommandId::SavePreferences;
 		}
 
+		if (parser.Found (L"stats"))
+		{
+			CheckCommandSingle();
+			ArgCommand = CommandId::DisplayVolumeStatistics;
+			param1IsMountedVolumeSpec = true;
+		}
+
 		if (parser.Found (L"test"))
 		{
 			CheckCommandSingle();
@@ -338,36 +375,10 @@ namespace VeraCrypt
 #endif
 
 		if (parser.Found (L"hash", &str))
-		{
-			ArgHash.reset();
-
-			foreach (shared_ptr <Hash> hash, Hash::GetAvailableAlgorithms())
-			{
-				wxString hashName (hash->GetName());
-				wxString hashAltName (hash->GetAltName());
-				if (hashName.IsSameAs (str, false) || hashAltName.IsSameAs (str, false))
-					ArgHash = hash;
-			}
-
-			if (!ArgHash)
-				throw_err (LangString["UNKNOWN_OPTION"] + L": " + str);
-		}
+			ArgHash = ToHash (str);
 
 		if (parser.Found (L"new-hash", &str))
-		{
-			ArgNewHash.reset();
-
-			foreach (shared_ptr <Hash> hash, Hash::GetAvailableAlgorithms())
-			{
-				wxString hashName (hash->GetName());
-				wxString hashAltName (hash->GetAltName());
-				if (hashName.IsSameAs (str, false) || hashAltName.IsSameAs (str, false))
-					ArgNewHash = hash;
-			}
-
-			if (!ArgNewHash)
-				throw_err (LangString["UNKNOWN_OPTION"] + L": " + str);
-		}
+			ArgNewHash = ToHash (str);
 
 		if (parser.Found (L"keyfiles", &str))
 			ArgKeyfiles = ToKeyfileList (str);
@@ -379,16 +390,53 @@ namespace VeraCrypt
 			{
 				wxString token = tokenizer.GetNextToken();
 
-				if (token == L"headerbak")
+				if (token == L"discard")
+					ArgMountOptions.AllowDiscards = true;
+				else if (token == L"directio")
+					ArgMountOptions.DirectIo = true;
+				else if (token.StartsWith (L"dmcrypt="))
+				{
+					// The listed flags replace the default ones
+					ArgMountOptions.KernelCryptoNoReadWorkqueue = false;
+					ArgMountOptions.KernelCryptoNoWriteWorkqueue = false;
+					ArgMountOptions.KernelCryptoSameCpu = false;
+					ArgMountOptions.KernelCryptoSubmitFromCryptCpus = false;
+
+					wxStringTokenizer flagTokenizer (token.AfterFirst (L'='), L"+");
+					while (flagTokenizer.HasMoreTokens())
+					{
+						wxString flag = flagTokenizer.GetNextToken();
+
+						if (flag == L"no_read_workqueue")
+							ArgMountOptions.KernelCryptoNoReadWorkqueue = true;
+						else if (flag == L"no_write_workqueue")
+							ArgMountOptions.KernelCryptoNoWriteWorkqueue = true;
+						else if (flag == L"same_cpu_crypt")
+							ArgMountOptions.KernelCryptoSameCpu = true;
+						else if (flag == L"submit_from_crypt_cpus")
+							ArgMountOptions.KernelCryptoSubmitFromCryptCpus = true;
+						else if (flag != L"none")
+							throw_err (LangString["UNKNOWN_OPTION"] + L": " + flag);
+					}
+				}
+				else if (token == L"headerbak")
 					ArgMountOptions.UseBackupHeaders = true;
+				else if (token.StartsWith (L"headerkeycache="))
+					ArgMountOptions.HeaderKeyCacheTimeout = StringConverter::ToUInt32 (wstring (token.AfterFirst (L'=')));
 				else if (token == L"nokernelcrypto")
 					ArgMountOptions.NoKernelCrypto = true;
+				else if (token.StartsWith (L"readahead="))
+					ArgMountOptions.ReadAheadSize = StringConverter::ToUInt32 (wstring (token.AfterFirst (L'=')));
 				else if (token == L"readonly" || token == L"ro")
 					ArgMountOptions.Protection = VolumeProtection::ReadOnly;
+				else if (token.StartsWith (L"sectorcache="))
+					ArgMountOptions.SectorCacheSize = StringConverter::ToUInt32 (wstring (token.AfterFirst (L'=')));
 				else if (token == L"system")
 					ArgMountOptions.PartitionInSystemEncryptionScope = true;
 				else if (token == L"timestamp" || token == L"ts")
 					ArgMountOptions.PreserveTimestamps = false;
+				else if (token.StartsWith (L"writeback="))
+					ArgMountOptions.WriteBackSize = StringConverter::ToUInt32 (wstring (token.AfterFirst (L'=')));
 #ifdef TC_WINDOWS
 				else if (token == L"removable" || token == L"rm")
 					ArgMountOptions.Removable = true;
@@ -504,22 +552,7 @@ namespace VeraCrypt
 		}
 
 		if (parser.Found (L"protection-hash", &str))
-		{
-			bool bHashFound = false;
-			foreach (shared_ptr <Hash> hash, Hash::GetAvailableAlgorithms())
-			{
-				wxString hashName (hash->GetName());
-				wxString hashAltName (hash->GetAltName());
-				if (hashName.IsSameAs (str, false) || hashAltName.IsSameAs (str, false))
-				{
-					bHashFound = true;
-					ArgMountOptions.ProtectionKdf = Pkcs5Kdf::GetAlgorithm (*hash, ArgTrueCryptMode);
-				}
-			}
-
-			if (!bHashFound)
-				throw_err (LangString["UNKNOWN_OPTION"] + L": " + str);
-		}
+			ArgMountOptions.ProtectionKdf = Pkcs5Kdf::GetAlgorithm (*ToHash (str), ArgTrueCryptMode);
 
 		ArgQuick = parser.Found (L"quick");
 
@@ -670,6 +703,9 @@ namespace VeraCrypt
 		if (param1IsMountedVolumeSpec)
 			ArgVolumes = GetMountedVolumes (parser.GetParamCount() > 0 ? parser.GetParam (0) : wxString());
 
+		if (ArgCommand == CommandId::ChangePasswordBatch)
+			ArgPasswordChanges = GetPasswordChanges (FilePath (wstring (passwordChangeManifest)));
+
 		if (ArgCommand == CommandId::None && Application::GetUserInterfaceType() == UserInterfaceType::Text)
 			parser.Usage();
 	}
@@ -684,6 +720,79 @@ namespace VeraCrypt
 			throw_err (_("Only a single command can be specified at a time."));
 	}
 
+	VolumePasswordChangeList CommandLineInterface::GetPasswordChanges (const FilePath &manifestPath) const
+	{
+		VolumePasswordChangeList changes;
+
+		// Credentials not specified for a volume default to those specified on the command line
+		foreach (XmlNode node, XmlParser (manifestPath).GetNodes (L"volume"))
+		{
+			VolumePasswordChange change;
+
+			if (node.InnerText.empty())
+				throw_err (LangString["PARAMETER_INCORRECT"] + L": " + wstring (manifestPath));
+
+			wxFileName volPath (node.InnerText);
+			volPath.Normalize (wxPATH_NORM_ABSOLUTE | wxPATH_NORM_DOTS);
+			change.Path.reset (new VolumePath (wstring (volPath.GetFullPath())));
+
+			change.CurrentHash = node.Attributes.count (L"hash") ? ToHash (node.Attributes[L"hash"]) : ArgHash;
+			change.Keyfiles = node.Attributes.count (L"keyfiles") ? ToKeyfileList (node.Attributes[L"keyfiles"]) : ArgKeyfiles;
+			change.NewHash = node.Attributes.count (L"new-hash") ? ToHash (node.Attributes[L"new-hash"]) : ArgNewHash;
+			change.NewKeyfiles = node.Attributes.count (L"new-keyfiles") ? ToKeyfileList (node.Attributes[L"new-keyfiles"]) : ArgNewKeyfiles;
+			change.NewPassword = node.Attributes.count (L"new-password") ? ToUTF8Password (node.Attributes[L"new-password"].c_str()) : ArgNewPassword;
+			change.Password = node.Attributes.count (L"password") ? ToUTF8Password (node.Attributes[L"password"].c_str()) : ArgPassword;
+
+			change.NewPim = ArgNewPim;
+			change.Pim = ArgPim;
+
+			try
+			{
+				if (node.Attributes.count (L"new-pim"))
+					change.NewPim = StringConverter::ToInt32 (wstring (node.Attributes[L"new-pim"]));
+
+				if (node.Attributes.count (L"pim"))
+					change.Pim = StringConverter::ToInt32 (wstring (node.Attributes[L"pim"]));
+			}
+			catch (...)
+			{
+				throw_err (LangString["PARAMETER_INCORRECT"] + L": " + node.InnerText);
+			}
+
+			if (change.NewPim > MAX_PIM_VALUE || change.Pim > MAX_PIM_VALUE || ((change.NewPim > 0 || change.Pim > 0) && ArgTrueCryptMode))
+				throw_err (LangString["PARAMETER_INCORRECT"] + L": " + node.InnerText);
+
+			changes.push_back (change);
+		}
+
+		if (changes.empty())
+			throw_err (LangString["PARAMETER_INCORRECT"] + L": " + wstring (manifestPath));
+
+		return changes;
+	}
+
+	shared_ptr <Hash> CommandLineInterface::ToHash (const wxString &arg) const
+	{
+		HashList hashes = Hash::GetAvailableAlgorithms();
+
+		// Hashes of KDFs which must be selected explicitly (e.g., Argon2id) are accepted only here
+		foreach (shared_ptr <Pkcs5Kdf> kdf, Pkcs5Kdf::GetAvailableAlgorithms (false))
+		{
+			if (kdf->IsExplicitSelectionRequired())
+				hashes.push_back (kdf->GetHash());
+		}
+
+		foreach (shared_ptr <Hash> hash, hashes)
+		{
+			wxString hashName (hash->GetName());
+			wxString hashAltName (hash->GetAltName());
+			if (hashName.IsSameAs (arg, false) || hashAltName.IsSameAs (arg, false))
+				return hash;
+		}
+
+		throw_err (LangString["UNKNOWN_OPTION"] + L": " + arg);
+	}
+
 	shared_ptr <KeyfileList> CommandLineInterface::ToKeyfileList (const wxString &arg) const
 	{
 		wxStringTokenizer tokenizer (arg, L",", wxTOKEN_RET_EMPTY_ALL);
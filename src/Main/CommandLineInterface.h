@@ -32,13 +32,16 @@ namespace VeraCrypt
 			AutoMountDevicesFavorites,
 			AutoMountFavorites,
 			BackupHeaders,
+			CalibrateKdf,
 			ChangePassword,
+			ChangePasswordBatch,
 			CreateKeyfile,
 			CreateVolume,
 			DeleteSecurityTokenKeyfiles,
 			DismountVolumes,
 			DisplayVersion,
 			DisplayVolumeProperties,
+			DisplayVolumeStatistics,
 			ExportSecurityTokenKeyfile,
 			Help,
 			ImportSecurityTokenKeyfiles,
@@ -51,6 +54,23 @@ namespace VeraCrypt
 		};
 	};
 
+	struct VolumePasswordChange
+	{
+		VolumePasswordChange () : NewPim (-1), Pim (-1) { }
+
+		shared_ptr <Hash> CurrentHash;
+		shared_ptr <KeyfileList> Keyfiles;
+		shared_ptr <Hash> NewHash;
+		shared_ptr <KeyfileList> NewKeyfiles;
+		shared_ptr <VolumePassword> NewPassword;
+		int NewPim;
+		shared_ptr <VolumePassword> Password;
+		int Pim;
+		shared_ptr <VolumePath> Path;
+	};
+
+	typedef list <VolumePasswordChange> VolumePasswordChangeList;
+
 	struct CommandLineInterface
 	{
 	public:
@@ -58,6 +78,7 @@ namespace VeraCrypt
 		virtual ~CommandLineInterface ();
 
 
+		uint32 ArgCalibrationTime;
 		CommandId::Enum ArgCommand;
 		bool ArgDisplayPassword;
 		shared_ptr <EncryptionAlgorithm> ArgEncryptionAlgorithm;
@@ -74,6 +95,7 @@ namespace VeraCrypt
 		int ArgNewPim;
 		bool ArgNoHiddenVolumeProtection;
 		shared_ptr <VolumePassword> ArgPassword;
+		VolumePasswordChangeList ArgPasswordChanges;
 		int ArgPim;
 		bool ArgQuick;
 		FilesystemPath ArgRandomSourcePath;
@@ -89,8 +111,10 @@ namespace VeraCrypt
 
 	protected:
 		void CheckCommandSingle () const;
+		shared_ptr <Hash> ToHash (const wxString &arg) const;
 		shared_ptr <KeyfileList> ToKeyfileList (const wxString &arg) const;
 		VolumeInfoList GetMountedVolumes (const wxString &filter) const;
+		VolumePasswordChangeList GetPasswordChanges (const FilePath &manifestPath) const;
 
 	private:
 		CommandLineInterface (const CommandLineInterface &);
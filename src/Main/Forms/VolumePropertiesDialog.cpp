@@ -81,6 +81,20 @@ namespace VeraCrypt
 #endif
 		AppendToList ("TOTAL_DATA_READ", Gui->SizeToString (volumeInfo.TotalDataRead));
 		AppendToList ("TOTAL_DATA_WRITTEN", Gui->SizeToString (volumeInfo.TotalDataWritten));
+
+		if (volumeInfo.SectorCacheHits > 0 || volumeInfo.SectorCacheMisses > 0)
+		{
+			AppendToList ("SECTOR_CACHE_HITS", StringConverter::FromNumber (volumeInfo.SectorCacheHits));
+			AppendToList ("SECTOR_CACHE_MISSES", StringConverter::FromNumber (volumeInfo.SectorCacheMisses));
+		}
+
+		for (int operation = 0; operation < VolumeStatistics::Operation::Count; ++operation)
+		{
+			VolumeStatistics::Operation::Enum op = static_cast <VolumeStatistics::Operation::Enum> (operation);
+
+			if (volumeInfo.Statistics.GetCount (op) > 0)
+				AppendToList (Gui->GetStatisticsLanguageKey (op), Gui->VolumeStatisticsToString (volumeInfo.Statistics, op));
+		}
 #ifdef TC_LINUX
 		}
 #endif
@@ -91,6 +91,7 @@ namespace VeraCrypt
 		virtual void ShowWarningTopMost (char *langStringId) const { ShowWarningTopMost (LangString[langStringId]); }
 		virtual void ShowWarningTopMost (const wxString &message) const;
 		virtual bool UpdateListCtrlItem (wxListCtrl *listCtrl, long itemIndex, const vector <wstring> &itemFields) const;
+		virtual void UserEnrichRandomPool () const { UserEnrichRandomPool (nullptr); }
 		virtual void UserEnrichRandomPool (wxWindow *parent, shared_ptr <Hash> hash = shared_ptr <Hash>()) const;
 		virtual void Yield () const;
 		virtual shared_ptr <VolumeInfo> MountVolumeThread (MountOptions &options) const;
@@ -25,9 +25,12 @@
 #include "Platform/SystemException.h"
 #include "Common/SecurityToken.h"
 #include "Volume/EncryptionTest.h"
+#include "Volume/EncryptionThreadPool.h"
+#include "Volume/Pkcs5KdfCalibration.h"
 #include "Application.h"
 #include "FavoriteVolume.h"
 #include "UserInterface.h"
+#include "VolumeMountHints.h"
 
 namespace VeraCrypt
 {
@@ -48,6 +51,178 @@ namespace VeraCrypt
 		catch (...) { }
 	}
 
+	void UserInterface::CalibrateKdf (uint32 targetTime, shared_ptr <Hash> hash) const
+	{
+		Pkcs5KdfList kdfs;
+
+		if (hash)
+			kdfs.push_back (Pkcs5Kdf::GetAlgorithm (*hash, false));
+		else
+			kdfs = Pkcs5Kdf::GetAvailableAlgorithms (false);
+
+		Pkcs5KdfCalibrationResultList results;
+		{
+			BusyScope busy (this);
+
+			foreach (shared_ptr <Pkcs5Kdf> kdf, kdfs)
+				results.push_back (Pkcs5KdfCalibration::Calibrate (*kdf, targetTime, MAX_PIM_VALUE));
+		}
+
+		Pkcs5KdfCalibrationResult recommendation = Pkcs5KdfCalibration::GetRecommendation (results);
+
+		// Machine-readable output
+		wxString message;
+		message << L"{\n  \"target_ms\": " << targetTime << L",\n  \"results\": [\n";
+
+		for (Pkcs5KdfCalibrationResultList::const_iterator i = results.begin(); i != results.end(); ++i)
+		{
+			message << L"    { \"prf\": \"" << wstring (i->KdfName) << L"\""
+				<< L", \"deprecated\": " << (i->Deprecated ? L"true" : L"false")
+				<< L", \"iterations_per_second\": " << i->IterationsPerSecond
+				<< L", \"parallel_iterations_per_second\": " << i->ParallelIterationsPerSecond
+				<< L", \"threads\": " << i->ThreadCount
+				<< L", \"default_ms\": " << i->DefaultTime
+				<< L", \"pim\": " << i->Pim
+				<< L", \"iterations\": " << i->IterationCount
+				<< L", \"estimated_ms\": " << i->EstimatedTime
+				<< L", \"within_target\": " << (i->WithinTarget ? L"true" : L"false") << L" }";
+
+			if (&*i != &results.back())
+				message << L',';
+			message << L'\n';
+		}
+
+		message << L"  ],\n  \"recommendation\": { \"prf\": \"" << wstring (recommendation.KdfName) << L"\", \"pim\": " << recommendation.Pim
+			<< L", \"estimated_ms\": " << recommendation.EstimatedTime << L" }\n}\n";
+
+		ShowString (message);
+	}
+
+	void UserInterface::ChangePasswords (const VolumePasswordChangeList &changes) const
+	{
+		struct BatchContext
+		{
+			BatchContext (bool preserveTimestamps, bool truecryptMode)
+				: NextChange (0), PreserveTimestamps (preserveTimestamps), TrueCryptMode (truecryptMode) { }
+
+			Mutex ContextMutex;
+			vector <const VolumePasswordChange *> Changes;
+			vector <wxString> Errors;
+			size_t NextChange;
+			bool PreserveTimestamps;
+			bool TrueCryptMode;
+		};
+
+		struct BatchFunctor : public Functor
+		{
+			BatchFunctor (BatchContext &context) : Context (context) { }
+
+			virtual void operator() ()
+			{
+				while (true)
+				{
+					size_t changeIndex;
+					{
+						ScopeLock lock (Context.ContextMutex);
+						if (Context.NextChange >= Context.Changes.size())
+							return;
+
+						changeIndex = Context.NextChange++;
+					}
+
+					const VolumePasswordChange &change = *Context.Changes[changeIndex];
+					wxString error;
+					bool hiddenKeyfilePresent = false;
+
+					try
+					{
+						// Keyfiles are applied here so that hidden files in keyfile paths are reported for this volume only
+						bool newHiddenKeyfilePresent;
+						shared_ptr <VolumePassword> password = Keyfile::ApplyListToPassword (change.Keyfiles, change.Password, hiddenKeyfilePresent);
+						shared_ptr <VolumePassword> newPassword = Keyfile::ApplyListToPassword (change.NewKeyfiles, change.NewPassword, newHiddenKeyfilePresent);
+
+						Core->ChangePassword (change.Path, Context.PreserveTimestamps, password, change.Pim,
+							change.CurrentHash ? Pkcs5Kdf::GetAlgorithm (*change.CurrentHash, Context.TrueCryptMode) : shared_ptr <Pkcs5Kdf>(),
+							Context.TrueCryptMode, shared_ptr <KeyfileList>(), newPassword, change.NewPim, shared_ptr <KeyfileList>(),
+							change.NewHash ? Pkcs5Kdf::GetAlgorithm (*change.NewHash, false) : shared_ptr <Pkcs5Kdf>());
+					}
+					catch (exception &e)
+					{
+						error = ExceptionToMessage (e);
+						if (error.empty())
+							error = L"?";
+						else if (hiddenKeyfilePresent && dynamic_cast <const PasswordException *> (&e))
+							error += GetHiddenKeyfilesWarning();
+					}
+					catch (...)
+					{
+						error = L"?";
+					}
+
+					ScopeLock lock (Context.ContextMutex);
+					Context.Errors[changeIndex] = error;
+				}
+			}
+
+			BatchContext &Context;
+		};
+
+		BatchContext context (Preferences.DefaultMountOptions.PreserveTimestamps, CmdLine->ArgTrueCryptMode);
+
+		foreach_ref (const VolumePasswordChange &change, changes)
+			context.Changes.push_back (&change);
+
+		context.Errors.resize (context.Changes.size());
+
+		if (!RandomNumberGenerator::IsRunning())
+			RandomNumberGenerator::Start();
+
+		// New salts and master key material of all volumes are drawn from the pool enriched once before the batch starts
+		RandomNumberGenerator::SetEnrichedByUserStatus (false);
+		UserEnrichRandomPool();
+
+		// Volumes are processed by a bounded number of workers whose header key derivations share the encryption thread pool
+		size_t workerCount = EncryptionThreadPool::GetCpuCount();
+		if (workerCount > context.Changes.size())
+			workerCount = context.Changes.size();
+
+		{
+			BusyScope busy (this);
+
+			list < shared_ptr <Thread> > threads;
+			for (size_t i = 0; i < workerCount; ++i)
+			{
+				make_shared_auto (Thread, thread);
+				thread->Start (new BatchFunctor (context));
+				threads.push_back (thread);
+			}
+
+			foreach (shared_ptr <Thread> thread, threads)
+				thread->Join();
+		}
+
+		wxString message;
+		size_t failedCount = 0;
+
+		for (size_t i = 0; i < context.Changes.size(); ++i)
+		{
+			if (context.Errors[i].empty())
+			{
+				message << L"OK: " << StringConverter::QuoteSpaces (*context.Changes[i]->Path) << L'\n';
+			}
+			else
+			{
+				message << L"FAILED: " << StringConverter::QuoteSpaces (*context.Changes[i]->Path) << L": " << context.Errors[i] << L'\n';
+				++failedCount;
+			}
+		}
+
+		ShowString (message);
+
+		if (failedCount > 0)
+			throw_err (StringFormatter (_("Password change failed for {0} of {1} volumes."), (uint64) failedCount, (uint64) context.Changes.size()));
+	}
+
 	void UserInterface::CheckRequirementsForMountingVolume () const
 	{
 #ifdef TC_LINUX
@@ -291,6 +466,20 @@ namespace VeraCrypt
 #endif
 			prop << LangString["TOTAL_DATA_READ"] << L": " << SizeToString (volume.TotalDataRead) << L'\n';
 			prop << LangString["TOTAL_DATA_WRITTEN"] << L": " << SizeToString (volume.TotalDataWritten) << L'\n';
+
+			if (volume.SectorCacheHits > 0 || volume.SectorCacheMisses > 0)
+			{
+				prop << LangString["SECTOR_CACHE_HITS"] << L": " << volume.SectorCacheHits << L'\n';
+				prop << LangString["SECTOR_CACHE_MISSES"] << L": " << volume.SectorCacheMisses << L'\n';
+			}
+
+			for (int operation = 0; operation < VolumeStatistics::Operation::Count; ++operation)
+			{
+				VolumeStatistics::Operation::Enum op = static_cast <VolumeStatistics::Operation::Enum> (operation);
+
+				if (volume.Statistics.GetCount (op) > 0)
+					prop << LangString[GetStatisticsLanguageKey (op)] << L": " << VolumeStatisticsToString (volume.Statistics, op) << L'\n';
+			}
 #ifdef TC_LINUX
 			}
 #endif
@@ -301,6 +490,77 @@ namespace VeraCrypt
 		ShowString (prop);
 	}
 
+	void UserInterface::DisplayVolumeStatistics (const VolumeInfoList &volumes) const
+	{
+		if (volumes.size() < 1)
+			throw_err (LangString["NO_VOLUMES_MOUNTED"]);
+
+		// Machine-readable output
+		wxString message;
+		message << L"{\n  \"volumes\": [\n";
+
+		for (VolumeInfoList::const_iterator v = volumes.begin(); v != volumes.end(); ++v)
+		{
+			const VolumeInfo &volume = **v;
+
+			wxString path = wstring (volume.Path);
+			path.Replace (L"\\", L"\\\\");
+			path.Replace (L"\"", L"\\\"");
+
+			message << L"    {\n      \"slot\": " << volume.SlotNumber
+				<< L",\n      \"volume\": \"" << path << L"\""
+				<< L",\n      \"total_data_read\": " << volume.TotalDataRead
+				<< L",\n      \"total_data_written\": " << volume.TotalDataWritten
+				<< L",\n      \"sector_cache_hits\": " << volume.SectorCacheHits
+				<< L",\n      \"sector_cache_misses\": " << volume.SectorCacheMisses
+				<< L",\n      \"operations\": {\n";
+
+			for (int operation = 0; operation < VolumeStatistics::Operation::Count; ++operation)
+			{
+				VolumeStatistics::Operation::Enum op = static_cast <VolumeStatistics::Operation::Enum> (operation);
+
+				message << L"        \"" << VolumeStatistics::GetOperationName (op) << L"\": {"
+					<< L" \"count\": " << volume.Statistics.GetCount (op)
+					<< L", \"latency_us\": " << volume.Statistics.GetLatency (op)
+					<< L", \"p50_us\": " << volume.Statistics.GetLatencyPercentile (op, 50)
+					<< L", \"p99_us\": " << volume.Statistics.GetLatencyPercentile (op, 99)
+					<< L", \"size_classes\": {\n";
+
+				for (int sizeClass = 0; sizeClass < VolumeStatistics::SizeClass::Count; ++sizeClass)
+				{
+					VolumeStatistics::SizeClass::Enum sc = static_cast <VolumeStatistics::SizeClass::Enum> (sizeClass);
+
+					message << L"          \"" << VolumeStatistics::GetSizeClassName (sc) << L"\": {"
+						<< L" \"count\": " << volume.Statistics.GetCount (op, sc)
+						<< L", \"bytes\": " << volume.Statistics.GetByteCount (op, sc)
+						<< L", \"latency_us\": " << volume.Statistics.GetLatency (op, sc)
+						<< L", \"latency_histogram\": [";
+
+					for (size_t bucket = 0; bucket < VolumeStatistics::LatencyBucketCount; ++bucket)
+					{
+						if (bucket > 0)
+							message << L", ";
+						message << volume.Statistics.GetLatencyBucket (op, sc, bucket);
+					}
+
+					message << L"] }" << (sizeClass + 1 < VolumeStatistics::SizeClass::Count ? L"," : L"") << L'\n';
+				}
+
+				message << L"        } }" << (operation + 1 < VolumeStatistics::Operation::Count ? L"," : L"") << L'\n';
+			}
+
+			message << L"      }\n    }";
+
+			if (&*v != &volumes.back())
+				message << L',';
+			message << L'\n';
+		}
+
+		message << L"  ]\n}\n";
+
+		ShowString (message);
+	}
+
 	wxString UserInterface::ExceptionToMessage (const exception &ex)
 	{
 		wxString message;
@@ -404,13 +664,7 @@ namespace VeraCrypt
 				message += wxString (L"\n\n") + LangString["CAPSLOCK_ON"];
 #endif
 			if (Keyfile::WasHiddenFilePresentInKeyfilePath())
-			{
-#ifdef TC_UNIX
-				message += _("\n\nWarning: Hidden files are present in a keyfile path. If you need to use them as keyfiles, remove the leading dot from their filenames. Hidden files are visible only if enabled in system options.");
-#else
-				message += LangString["HIDDEN_FILES_PRESENT_IN_KEYFILE_PATH"];
-#endif
-			}
+				message += GetHiddenKeyfilesWarning();
 
 			return message;
 		}
@@ -500,6 +754,29 @@ namespace VeraCrypt
 		return L"";
 	}
 
+	wxString UserInterface::GetHiddenKeyfilesWarning ()
+	{
+#ifdef TC_UNIX
+		return _("\n\nWarning: Hidden files are present in a keyfile path. If you need to use them as keyfiles, remove the leading dot from their filenames. Hidden files are visible only if enabled in system options.");
+#else
+		return LangString["HIDDEN_FILES_PRESENT_IN_KEYFILE_PATH"];
+#endif
+	}
+
+	const char *UserInterface::GetStatisticsLanguageKey (VolumeStatistics::Operation::Enum operation)
+	{
+		switch (operation)
+		{
+		case VolumeStatistics::Operation::HostRead:		return "HOST_READ_LATENCY";
+		case VolumeStatistics::Operation::HostWrite:	return "HOST_WRITE_LATENCY";
+		case VolumeStatistics::Operation::Decrypt:		return "DECRYPTION_LATENCY";
+		case VolumeStatistics::Operation::Encrypt:		return "ENCRYPTION_LATENCY";
+		case VolumeStatistics::Operation::ReadRequest:	return "READ_REQUEST_LATENCY";
+		case VolumeStatistics::Operation::WriteRequest:	return "WRITE_REQUEST_LATENCY";
+		default:										throw ParameterIncorrect (SRC_POS);
+		}
+	}
+
 	void UserInterface::Init ()
 	{
 		SetAppName (Application::GetName());
@@ -621,6 +898,7 @@ namespace VeraCrypt
 			options.SlotNumber = Core->GetFirstFreeSlotNumber (options.SlotNumber);
 			options.MountPoint.reset (new DirectoryPath);
 			options.Path.reset (new VolumePath (device.Path));
+			VolumeMountHints::ApplyTo (options);
 
 			try
 			{
@@ -648,6 +926,8 @@ namespace VeraCrypt
 						continue;
 				}
 
+				VolumeMountHints::Record (*newMountedVolumes.back());
+
 				if (newMountedVolumes.back()->Protection == VolumeProtection::HiddenVolumeReadOnly)
 					protectedVolumeMounted = true;
 
@@ -699,11 +979,13 @@ namespace VeraCrypt
 			}
 
 			favorite.ToMountOptions (options);
+			VolumeMountHints::ApplyTo (options);
 
 			if (Preferences.NonInteractive)
 			{
 				BusyScope busy (this);
 				newMountedVolumes.push_back (Core->MountVolume (options));
+				VolumeMountHints::Record (*newMountedVolumes.back());
 			}
 			else
 			{
@@ -711,6 +993,7 @@ namespace VeraCrypt
 				{
 					BusyScope busy (this);
 					newMountedVolumes.push_back (Core->MountVolume (options));
+					VolumeMountHints::Record (*newMountedVolumes.back());
 				}
 				catch (...)
 				{
@@ -739,6 +1022,7 @@ namespace VeraCrypt
 	shared_ptr <VolumeInfo> UserInterface::MountVolume (MountOptions &options) const
 	{
 		shared_ptr <VolumeInfo> volume;
+		VolumeMountHints::ApplyTo (options);
 
 		try
 		{
@@ -764,6 +1048,8 @@ namespace VeraCrypt
 			}
 		}
 
+		VolumeMountHints::Record (*volume);
+
 		if (volume->EncryptionAlgorithmMinBlockSize == 8)
 			ShowWarning ("WARN_64_BIT_BLOCK_CIPHER");
 
@@ -975,7 +1261,9 @@ namespace VeraCrypt
 						if (!cmdLine.ArgMountOptions.Path)
 							throw MissingArgument (SRC_POS);
 
+						VolumeMountHints::ApplyTo (cmdLine.ArgMountOptions);
 						mountedVolumes.push_back (Core->MountVolume (cmdLine.ArgMountOptions));
+						VolumeMountHints::Record (*mountedVolumes.back());
 					}
 					else
 					{
@@ -1011,10 +1299,18 @@ namespace VeraCrypt
 			BackupVolumeHeaders (cmdLine.ArgVolumePath);
 			return true;
 
+		case CommandId::CalibrateKdf:
+			CalibrateKdf (cmdLine.ArgCalibrationTime, cmdLine.ArgHash);
+			return true;
+
 		case CommandId::ChangePassword:
 			ChangePassword (cmdLine.ArgVolumePath, cmdLine.ArgPassword, cmdLine.ArgPim, cmdLine.ArgHash, cmdLine.ArgTrueCryptMode, cmdLine.ArgKeyfiles, cmdLine.ArgNewPassword, cmdLine.ArgNewPim, cmdLine.ArgNewKeyfiles, cmdLine.ArgNewHash);
 			return true;
 
+		case CommandId::ChangePasswordBatch:
+			ChangePasswords (cmdLine.ArgPasswordChanges);
+			return true;
+
 		case CommandId::CreateKeyfile:
 			CreateKeyfile (cmdLine.ArgFilePath);
 			return true;
@@ -1061,6 +1357,10 @@ namespace VeraCrypt
 			DisplayVolumeProperties (cmdLine.ArgVolumes);
 			return true;
 
+		case CommandId::DisplayVolumeStatistics:
+			DisplayVolumeStatistics (cmdLine.ArgVolumes);
+			return true;
+
 		case CommandId::Help:
 			{
 				wstring helpText = StringConverter::ToWide (
@@ -1079,6 +1379,12 @@ namespace VeraCrypt
 					" Backup volume headers to a file. All required options are requested from the\n"
 					" user.\n"
 					"\n"
+					"--calibrate-pim=MILLISECONDS\n"
+					" Measure the key derivation speed of this computer and display, for each PRF,\n"
+					" the highest PIM whose header key derivation takes at most MILLISECONDS, in\n"
+					" JSON format, and recommend the PRF that uses most of that time. Option --hash\n"
+					" restricts the calibration to one PRF.\n"
+					"\n"
 					"-c, --create[=VOLUME_PATH]\n"
 					" Create a new volume. Most options are requested from the user if not specified\n"
 					" on command line. See also options --encryption, -k, --filesystem, --hash, -p,\n"
@@ -1105,6 +1411,15 @@ namespace VeraCrypt
 					" algorithm can be changed with option --hash. See also options -k,\n"
 					" --new-keyfiles, --new-password, -p, --random-source.\n"
 					"\n"
+					"--change-batch=MANIFEST_FILE\n"
+					" Change passwords and/or keyfiles of all volumes listed in MANIFEST_FILE.\n"
+					" Several volumes are processed concurrently and the result is displayed for\n"
+					" each volume. The manifest contains one element per volume:\n"
+					"  <volume password=\"OLD\" new-password=\"NEW\">VOLUME_PATH</volume>\n"
+					" Optional attributes pim, keyfiles, hash, new-pim, new-keyfiles and new-hash\n"
+					" have the same meaning as the corresponding options. Attributes not specified\n"
+					" default to the values of the options specified on command line.\n"
+					"\n"
 					"-d, --dismount[=MOUNTED_VOLUME]\n"
 					" Dismount a mounted volume. If MOUNTED_VOLUME is not specified, all\n"
 					" volumes are dismounted. See below for description of MOUNTED_VOLUME.\n"
@@ -1139,6 +1454,15 @@ namespace VeraCrypt
 					"--save-preferences\n"
 					" Save user preferences.\n"
 					"\n"
+					"--stats[=MOUNTED_VOLUME]\n"
+					" Display I/O statistics of a mounted volume in JSON format. Operation counts,\n"
+					" transferred bytes and log2-bucketed latency histograms (bucket N counts\n"
+					" latencies of 2^N to 2^(N+1)-1 microseconds) are listed per operation and\n"
+					" request size class. Host read/write and decrypt/encrypt latencies show\n"
+					" whether a slow volume is limited by its storage or by encryption. Statistics\n"
+					" are collected only for volumes served by the FUSE service. See below for\n"
+					" description of MOUNTED_VOLUME.\n"
+					"\n"
 					"--test\n"
 					" Test internal algorithms used in the process of encryption and decryption.\n"
 					"\n"
@@ -1182,7 +1506,10 @@ namespace VeraCrypt
 					"--hash=HASH\n"
 					" Use specified hash algorithm when creating a new volume or changing password\n"
 					" and/or keyfiles. This option also specifies the mixing PRF of the random\n"
-					" number generator.\n"
+					" number generator. HASH 'Argon2id' selects the memory-hard Argon2id key\n"
+					" derivation function, whose memory and time costs grow with PIM up to a\n"
+					" fixed bound. Volumes using Argon2id can be mounted only when it is selected\n"
+					" with this option. Argon2id does not change the random number generator.\n"
 					"\n"
 					"-k, --keyfiles=KEYFILE1[,KEYFILE2,KEYFILE3,...]\n"
 					" Use specified keyfiles when mounting a volume or when changing password\n"
@@ -1199,14 +1526,51 @@ namespace VeraCrypt
 					"\n"
 					"-m, --mount-options=OPTION1[,OPTION2,OPTION3,...]\n"
 					" Specifies comma-separated mount options for a VeraCrypt volume:\n"
+					"  discard: Pass discard (TRIM) requests of the mounted file system to the host\n"
+					"   file or device. Discarded sectors of a file container are deallocated and\n"
+					"   discarded sectors of a device are unmapped if the device reads them as\n"
+					"   zeros. Discarded sectors are read as zeros. WARNING: This\n"
+					"   reveals which parts of the volume are unused, which may leak information\n"
+					"   about the file system and its use, and which allows an adversary to\n"
+					"   detect whether the volume is likely to contain a hidden volume. Ignored\n"
+					"   when the volume is mounted with hidden volume protection.\n"
+					"  directio: Read and write the host file or device without using the system\n"
+					"   cache, so that only decrypted data is cached. Used only if the host supports\n"
+					"   direct I/O with the sector size of the volume.\n"
+					"  dmcrypt=FLAG1[+FLAG2+...]|none: Performance flags of kernel cryptographic\n"
+					"   services (dm-crypt), each used only if supported by the running kernel:\n"
+					"   no_read_workqueue and no_write_workqueue (Linux 5.12 and later) process\n"
+					"   requests without queuing them to kernel worker threads, which lowers the\n"
+					"   latency on fast storage. same_cpu_crypt and submit_from_crypt_cpus (Linux\n"
+					"   4.0 and later) encrypt on the CPU that issued the request and submit\n"
+					"   writes from the encrypting CPU. Default: no_read_workqueue+no_write_workqueue\n"
+					"   on Linux 5.12 and later, no flags on earlier kernels.\n"
 					"  headerbak: Use backup headers when mounting a volume.\n"
+					"  headerkeycache=SECONDS: Keep the derived header key in locked memory of the\n"
+					"   privileged service process for the specified number of seconds. Only the\n"
+					"   VeraCrypt instance that mounted the volume (e.g., the GUI or a background\n"
+					"   task) reuses the key when it remounts the volume with the same password.\n"
+					"   The option has no effect on separate command-line invocations, as each of\n"
+					"   them starts its own service process. The key is removed when it expires or\n"
+					"   when the password cache is wiped.\n"
 					"  nokernelcrypto: Do not use kernel cryptographic services.\n"
+					"  readahead=MIB: Read and decrypt up to the specified number of megabytes ahead\n"
+					"   of sequential reads (default: 4, 0 disables read-ahead). Used only when\n"
+					"   kernel cryptographic services are not used.\n"
 					"  readonly|ro: Mount volume as read-only.\n"
+					"  sectorcache=MIB: Keep up to the specified number of megabytes of decrypted\n"
+					"   volume data in locked memory, so that data read repeatedly is not decrypted\n"
+					"   again. Used only when kernel cryptographic services are not used.\n"
 					"  system: Mount partition using system encryption.\n"
 					"  timestamp|ts: Do not restore host-file modification timestamp when a volume\n"
 					"   is dismounted (note that the operating system under certain circumstances\n"
 					"   does not alter host-file timestamps, which may be mistakenly interpreted\n"
 					"   to mean that this option does not work).\n"
+					"  writeback=MIB: Buffer up to the specified number of megabytes of written data\n"
+					"   and write it in the background, merging adjacent writes. Buffered data is\n"
+					"   written when the volume image is flushed or synchronized, and when the\n"
+					"   volume is dismounted. Used only when kernel cryptographic services are not\n"
+					"   used.\n"
 					" See also option --fs-options.\n"
 					"\n"
 					"--new-keyfiles=KEYFILE1[,KEYFILE2,KEYFILE3,...]\n"
@@ -1517,6 +1881,18 @@ namespace VeraCrypt
 		return ext.IsSameAs (L"exe") || ext.IsSameAs (L"sys") || ext.IsSameAs (L"dll");
 	}
 
+	wxString UserInterface::VolumeStatisticsToString (const VolumeStatistics &statistics, VolumeStatistics::Operation::Enum operation) const
+	{
+		uint64 count = statistics.GetCount (operation);
+		uint64 byteCount = 0;
+
+		for (int sizeClass = 0; sizeClass < VolumeStatistics::SizeClass::Count; ++sizeClass)
+			byteCount += statistics.GetByteCount (operation, static_cast <VolumeStatistics::SizeClass::Enum> (sizeClass));
+
+		return StringFormatter (LangString["VOLUME_LATENCY_SUMMARY"], count, SizeToString (byteCount),
+			count > 0 ? statistics.GetLatency (operation) / count : 0, statistics.GetLatencyPercentile (operation, 99));
+	}
+
 	wxString UserInterface::VolumeTimeToString (VolumeTime volumeTime) const
 	{
 		wxString dateStr = VolumeTimeToDateTime (volumeTime).Format();
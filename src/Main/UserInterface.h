@@ -33,7 +33,9 @@ namespace VeraCrypt
 		virtual bool AskYesNo (const wxString &message, bool defaultYes = false, bool warning = false) const = 0;
 		virtual void BackupVolumeHeaders (shared_ptr <VolumePath> volumePath) const = 0;
 		virtual void BeginBusyState () const = 0;
+		virtual void CalibrateKdf (uint32 targetTime, shared_ptr <Hash> hash = shared_ptr <Hash>()) const;
 		virtual void ChangePassword (shared_ptr <VolumePath> volumePath = shared_ptr <VolumePath>(), shared_ptr <VolumePassword> password = shared_ptr <VolumePassword>(), int pim = 0, shared_ptr <Hash> currentHash = shared_ptr <Hash>(), bool truecryptMode = false, shared_ptr <KeyfileList> keyfiles = shared_ptr <KeyfileList>(), shared_ptr <VolumePassword> newPassword = shared_ptr <VolumePassword>(), int newPim = 0, shared_ptr <KeyfileList> newKeyfiles = shared_ptr <KeyfileList>(), shared_ptr <Hash> newHash = shared_ptr <Hash>()) const = 0;
+		virtual void ChangePasswords (const VolumePasswordChangeList &changes) const;
 		virtual void CheckRequirementsForMountingVolume () const;
 		virtual void CloseExplorerWindows (shared_ptr <VolumeInfo> mountedVolume) const;
 		virtual void CreateKeyfile (shared_ptr <FilePath> keyfilePath = shared_ptr <FilePath>()) const = 0;
@@ -43,6 +45,7 @@ namespace VeraCrypt
 		virtual void DismountVolume (shared_ptr <VolumeInfo> volume, bool ignoreOpenFiles = false, bool interactive = true) const;
 		virtual void DismountVolumes (VolumeInfoList volumes, bool ignoreOpenFiles = false, bool interactive = true) const;
 		virtual void DisplayVolumeProperties (const VolumeInfoList &volumes) const;
+		virtual void DisplayVolumeStatistics (const VolumeInfoList &volumes) const;
 		virtual void DoShowError (const wxString &message) const = 0;
 		virtual void DoShowInfo (const wxString &message) const = 0;
 		virtual void DoShowString (const wxString &str) const = 0;
@@ -52,6 +55,7 @@ namespace VeraCrypt
 		virtual void ExportSecurityTokenKeyfile () const = 0;
 		virtual shared_ptr <GetStringFunctor> GetAdminPasswordRequestHandler () = 0;
 		virtual const UserPreferences &GetPreferences () const { return Preferences; }
+		static const char *GetStatisticsLanguageKey (VolumeStatistics::Operation::Enum operation);
 		virtual void ImportSecurityTokenKeyfiles () const = 0;
 		virtual void Init ();
 		virtual void InitSecurityTokenLibrary () const = 0;
@@ -78,7 +82,9 @@ namespace VeraCrypt
 		virtual wxString SpeedToString (uint64 speed) const;
 		virtual void Test () const;
 		virtual wxString TimeSpanToString (uint64 seconds) const;
+		virtual void UserEnrichRandomPool () const = 0;
 		virtual bool VolumeHasUnrecommendedExtension (const VolumePath &path) const;
+		virtual wxString VolumeStatisticsToString (const VolumeStatistics &statistics, VolumeStatistics::Operation::Enum operation) const;
 		virtual void Yield () const = 0;
 		virtual WaitThreadUI* GetWaitThreadUI(WaitThreadRoutine *pRoutine) const { return new WaitThreadUI(pRoutine);}
 		virtual wxDateTime VolumeTimeToDateTime (VolumeTime volumeTime) const { return wxDateTime ((time_t) (volumeTime / 1000ULL / 1000 / 10 - 134774ULL * 24 * 3600)); }
@@ -106,6 +112,7 @@ namespace VeraCrypt
 
 		static wxString ExceptionToString (const Exception &ex);
 		static wxString ExceptionTypeToString (const std::type_info &ex);
+		static wxString GetHiddenKeyfilesWarning ();
 
 		UserPreferences Preferences;
 		UserInterfaceType::Enum InterfaceType;
@@ -86,10 +86,20 @@ namespace VeraCrypt
 			TC_CONFIG_SET (DismountOnScreenSaver);
 			TC_CONFIG_SET (DisplayMessageAfterHotkeyDismount);
 			TC_CONFIG_SET (BackgroundTaskEnabled);
+			SetValue (configMap[L"AllowDiscards"], DefaultMountOptions.AllowDiscards);
+			SetValue (configMap[L"DirectIo"], DefaultMountOptions.DirectIo);
 			SetValue (configMap[L"FilesystemOptions"], DefaultMountOptions.FilesystemOptions);
+			SetValue (configMap[L"HeaderKeyCacheTimeout"], DefaultMountOptions.HeaderKeyCacheTimeout);
+			SetValue (configMap[L"KernelCryptoNoReadWorkqueue"], DefaultMountOptions.KernelCryptoNoReadWorkqueue);
+			SetValue (configMap[L"KernelCryptoNoWriteWorkqueue"], DefaultMountOptions.KernelCryptoNoWriteWorkqueue);
+			SetValue (configMap[L"KernelCryptoSameCpu"], DefaultMountOptions.KernelCryptoSameCpu);
+			SetValue (configMap[L"KernelCryptoSubmitFromCryptCpus"], DefaultMountOptions.KernelCryptoSubmitFromCryptCpus);
 			TC_CONFIG_SET (ForceAutoDismount);
 			TC_CONFIG_SET (LastSelectedSlotNumber);
 			TC_CONFIG_SET (MaxVolumeIdleTime);
+			SetValue (configMap[L"ReadAheadSize"], DefaultMountOptions.ReadAheadSize);
+			SetValue (configMap[L"SectorCacheSize"], DefaultMountOptions.SectorCacheSize);
+			SetValue (configMap[L"WriteBackSize"], DefaultMountOptions.WriteBackSize);
 			TC_CONFIG_SET (MountDevicesOnLogon);
 			TC_CONFIG_SET (MountFavoritesOnLogon);
 
@@ -103,6 +113,7 @@ namespace VeraCrypt
 			TC_CONFIG_SET (OpenExplorerWindowAfterMount);
 			SetValue (configMap[L"PreserveTimestamps"], DefaultMountOptions.PreserveTimestamps);
 			TC_CONFIG_SET (SaveHistory);
+			TC_CONFIG_SET (SaveMountHints);
 			SetValue (configMap[L"SecurityTokenLibrary"], SecurityTokenModule);
 			TC_CONFIG_SET (StartOnLogon);
 			TC_CONFIG_SET (UseKeyfiles);
@@ -204,10 +215,20 @@ namespace VeraCrypt
 		TC_CONFIG_ADD (DismountOnScreenSaver);
 		TC_CONFIG_ADD (DisplayMessageAfterHotkeyDismount);
 		TC_CONFIG_ADD (BackgroundTaskEnabled);
+		formatter.AddEntry (L"AllowDiscards", DefaultMountOptions.AllowDiscards);
+		formatter.AddEntry (L"DirectIo", DefaultMountOptions.DirectIo);
 		formatter.AddEntry (L"FilesystemOptions", DefaultMountOptions.FilesystemOptions);
+		formatter.AddEntry (L"HeaderKeyCacheTimeout", DefaultMountOptions.HeaderKeyCacheTimeout);
+		formatter.AddEntry (L"KernelCryptoNoReadWorkqueue", DefaultMountOptions.KernelCryptoNoReadWorkqueue);
+		formatter.AddEntry (L"KernelCryptoNoWriteWorkqueue", DefaultMountOptions.KernelCryptoNoWriteWorkqueue);
+		formatter.AddEntry (L"KernelCryptoSameCpu", DefaultMountOptions.KernelCryptoSameCpu);
+		formatter.AddEntry (L"KernelCryptoSubmitFromCryptCpus", DefaultMountOptions.KernelCryptoSubmitFromCryptCpus);
 		TC_CONFIG_ADD (ForceAutoDismount);
 		TC_CONFIG_ADD (LastSelectedSlotNumber);
 		TC_CONFIG_ADD (MaxVolumeIdleTime);
+		formatter.AddEntry (L"ReadAheadSize", DefaultMountOptions.ReadAheadSize);
+		formatter.AddEntry (L"SectorCacheSize", DefaultMountOptions.SectorCacheSize);
+		formatter.AddEntry (L"WriteBackSize", DefaultMountOptions.WriteBackSize);
 		TC_CONFIG_ADD (MountDevicesOnLogon);
 		TC_CONFIG_ADD (MountFavoritesOnLogon);
 		formatter.AddEntry (L"MountVolumesReadOnly", DefaultMountOptions.Protection == VolumeProtection::ReadOnly);
@@ -217,6 +238,7 @@ namespace VeraCrypt
 		TC_CONFIG_ADD (OpenExplorerWindowAfterMount);
 		formatter.AddEntry (L"PreserveTimestamps", DefaultMountOptions.PreserveTimestamps);
 		TC_CONFIG_ADD (SaveHistory);
+		TC_CONFIG_ADD (SaveMountHints);
 		formatter.AddEntry (L"SecurityTokenLibrary", wstring (SecurityTokenModule));
 		TC_CONFIG_ADD (StartOnLogon);
 		TC_CONFIG_ADD (UseKeyfiles);
@@ -46,6 +46,7 @@ namespace VeraCrypt
 			UseStandardInput (false),
 			OpenExplorerWindowAfterMount (false),
 			SaveHistory (false),
+			SaveMountHints (false),
 			StartOnLogon (false),
 			UseKeyfiles (false),
 			Verbose (false),
@@ -87,6 +88,7 @@ namespace VeraCrypt
 		bool UseStandardInput;
 		bool OpenExplorerWindowAfterMount;
 		bool SaveHistory;
+		bool SaveMountHints;
 		FilePath SecurityTokenModule;
 		bool StartOnLogon;
 		bool UseKeyfiles;
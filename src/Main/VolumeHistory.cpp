@@ -15,6 +15,7 @@
 #include "GraphicUserInterface.h"
 #include "Xml.h"
 #include "VolumeHistory.h"
+#include "VolumeMountHints.h"
 
 namespace VeraCrypt
 {
@@ -63,6 +64,7 @@ namespace VeraCrypt
 		}
 
 		Save();
+		VolumeMountHints::Clear();
 	}
 
 	void VolumeHistory::ConnectComboBox (wxComboBox *comboBox)
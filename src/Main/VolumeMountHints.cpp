@@ -0,0 +1,135 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+
+#include "System.h"
+#include "Application.h"
+#include "UserInterface.h"
+#include "Xml.h"
+#include "VolumeMountHints.h"
+
+namespace VeraCrypt
+{
+	void VolumeMountHints::ApplyTo (MountOptions &options)
+	{
+		options.Hint = VolumeOpenHint();
+
+		if (!options.Path || !IsEnabled())
+			return;
+
+		ScopeLock lock (AccessMutex);
+		Load();
+
+		HintMap::const_iterator hint = Hints.find (wstring (*options.Path));
+		if (hint != Hints.end())
+			options.Hint = hint->second;
+	}
+
+	void VolumeMountHints::Clear ()
+	{
+		ScopeLock lock (AccessMutex);
+
+		Hints.clear();
+		Loaded = true;
+
+		FilePath hintsCfgPath = Application::GetConfigFilePath (GetFileName());
+		if (hintsCfgPath.IsFile())
+			hintsCfgPath.Delete();
+	}
+
+	bool VolumeMountHints::IsEnabled ()
+	{
+		UserInterface *ui = Application::GetUserInterface();
+		return ui && ui->GetPreferences().SaveMountHints;
+	}
+
+	void VolumeMountHints::Load ()
+	{
+		if (Loaded)
+			return;
+
+		Loaded = true;
+		FilePath hintsCfgPath = Application::GetConfigFilePath (GetFileName());
+
+		if (hintsCfgPath.IsFile())
+		{
+			foreach (XmlNode node, XmlParser (hintsCfgPath).GetNodes (L"volume"))
+			{
+				VolumeOpenHint hint;
+				wstring attr = wstring (node.Attributes[L"type"]);
+				if (!attr.empty())
+					hint.Type = static_cast <VolumeType::Enum> (StringConverter::ToUInt32 (attr));
+
+				hint.KdfName = wstring (node.Attributes[L"kdf"]);
+				hint.EncryptionAlgorithmName = wstring (node.Attributes[L"ea"]);
+
+				Hints[wstring (node.InnerText)] = hint;
+			}
+		}
+	}
+
+	void VolumeMountHints::Record (const VolumeInfo &volume)
+	{
+		// Recording hidden volumes would disclose their existence
+		if (volume.Type != VolumeType::Normal || volume.Path.IsEmpty() || !IsEnabled())
+			return;
+
+		ScopeLock lock (AccessMutex);
+		Load();
+
+		VolumeOpenHint &hint = Hints[wstring (volume.Path)];
+		if (hint.Type == volume.Type && hint.KdfName == volume.Pkcs5PrfName && hint.EncryptionAlgorithmName == volume.EncryptionAlgorithmName)
+			return;
+
+		hint = VolumeOpenHint (volume.Type, volume.Pkcs5PrfName, volume.EncryptionAlgorithmName);
+
+		// Hints are only an optimization and must not fail a mount
+		try
+		{
+			Save();
+		}
+		catch (...) { }
+	}
+
+	void VolumeMountHints::Save ()
+	{
+		FilePath hintsCfgPath = Application::GetConfigFilePath (GetFileName(), true);
+
+		if (Hints.empty())
+		{
+			if (hintsCfgPath.IsFile())
+				hintsCfgPath.Delete();
+		}
+		else
+		{
+			XmlNode hintsXml (L"mounthints");
+
+			foreach (const HintMap::value_type &entry, Hints)
+			{
+				XmlNode node (L"volume", entry.first);
+				node.Attributes[L"type"] = StringConverter::FromNumber (static_cast <uint32> (entry.second.Type));
+				node.Attributes[L"kdf"] = entry.second.KdfName;
+				node.Attributes[L"ea"] = entry.second.EncryptionAlgorithmName;
+
+				hintsXml.InnerNodes.push_back (node);
+			}
+
+			XmlWriter hintsWriter (hintsCfgPath);
+			hintsWriter.WriteNode (hintsXml);
+			hintsWriter.Close();
+		}
+	}
+
+	VolumeMountHints::HintMap VolumeMountHints::Hints;
+	bool VolumeMountHints::Loaded = false;
+	Mutex VolumeMountHints::AccessMutex;
+}
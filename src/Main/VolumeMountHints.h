@@ -0,0 +1,51 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+
+#ifndef TC_HEADER_Main_VolumeMountHints
+#define TC_HEADER_Main_VolumeMountHints
+
+#include "System.h"
+#include "Main.h"
+
+namespace VeraCrypt
+{
+	// Remembers per volume path the layout type, KDF and encryption algorithm of the last
+	// successful mount. Hints disclose the algorithms of each volume and are therefore
+	// kept only when enabled by the SaveMountHints preference.
+	class VolumeMountHints
+	{
+	public:
+		static void ApplyTo (MountOptions &options);
+		static void Clear ();
+		static void Record (const VolumeInfo &volume);
+
+	protected:
+		static wxString GetFileName () { return L"Mount Hints.xml"; }
+		static bool IsEnabled ();
+		static void Load ();
+		static void Save ();
+
+		typedef map <wstring, VolumeOpenHint> HintMap;
+
+		static HintMap Hints;
+		static bool Loaded;
+		static Mutex AccessMutex;
+
+	private:
+		VolumeMountHints ();
+		VolumeMountHints (const VolumeMountHints &);
+		VolumeMountHints &operator= (const VolumeMountHints &);
+	};
+}
+
+#endif // TC_HEADER_Main_VolumeMountHints
@@ -0,0 +1,104 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+#ifndef TC_HEADER_Platform_AsyncFileIo
+#define TC_HEADER_Platform_AsyncFileIo
+
+#include "PlatformBase.h"
+#include "Buffer.h"
+#include "File.h"
+#include "SharedPtr.h"
+
+namespace VeraCrypt
+{
+	// Performs reads and writes of a file in batches. Queued requests are submitted together and
+	// complete in any order. On Linux, requests are submitted through io_uring with the file registered
+	// as a fixed file; where io_uring is not available, requests are performed when they are submitted.
+	// Completions are timed when they are first seen in the ring, including when further requests are queued.
+	// An instance must not be used by more than one thread at a time.
+	class AsyncFileIo
+	{
+	public:
+		AsyncFileIo (shared_ptr <File> file, size_t queueDepth = DefaultQueueDepth);
+		virtual ~AsyncFileIo ();
+
+		void Drain (); // Waits for all submitted requests and ignores their errors
+		size_t GetPendingCount () const { return QueuedCount + SubmittedCount; }
+		size_t GetQueueDepth () const { return QueueDepth; }
+		bool IsAsync () const { return RingFd != -1; }
+		static bool IsSupported ();
+		void QueueRead (const BufferPtr &buffer, uint64 position, uint64 requestId);
+		void QueueWrite (const ConstBufferPtr &buffer, uint64 position, uint64 requestId);
+		void Submit ();
+		uint64 WaitForCompletion (size_t *transferredSize = nullptr, uint64 *latency = nullptr); // Returns the ID of a completed request. Short transfers are completed synchronously; reads stop at end of file.
+
+		static const size_t DefaultQueueDepth = 32;
+
+	protected:
+		struct Request
+		{
+			Request () : Buffer (nullptr), CompletionTime (0), Id (0), Position (0), QueueTime (0), Size (0), Write (false) { }
+
+			byte *Buffer;
+			uint64 CompletionTime;
+			uint64 Id;
+			uint64 Position;
+			uint64 QueueTime;
+			size_t Size;
+			bool Write;
+		};
+
+		void AbandonRequests (); // Cancels requests in flight and waits until their buffers are no longer accessed
+		void CloseRing ();
+		size_t CompleteRequest (const Request &request, ssize_t result) const;
+		static uint64 GetTime (); // Microseconds
+		void Queue (byte *buffer, size_t size, uint64 position, uint64 requestId, bool write);
+		bool SetupRing ();
+		void TimeCompletions ();
+
+		shared_ptr <File> IoFile;
+		size_t QueueDepth;
+		size_t QueuedCount;
+		vector <Request> Requests;
+		list <size_t> FreeSlots;
+		list <size_t> CompletedSlots; // Requests performed synchronously
+		size_t SubmittedCount;
+
+		int RingFd;
+		byte *SubmissionRing;
+		size_t SubmissionRingSize;
+		byte *CompletionRing;
+		size_t CompletionRingSize;
+		byte *SubmissionEntries;
+		size_t SubmissionEntriesSize;
+		uint32 *SubmissionHead;
+		uint32 *SubmissionTail;
+		uint32 SubmissionMask;
+		uint32 *SubmissionArray;
+		uint32 *CompletionHead;
+		uint32 *CompletionTail;
+		uint32 CompletionMask;
+		uint32 TimedCompletionTail; // Completions up to this position have their time recorded
+		byte *CompletionEntries;
+		void *IoVectors;
+
+		static const uint64 CancelRequestData = 0xffffFFFFffffFFFFULL;
+		static const int MaxDrainAttempts = 100;
+		static int Supported;
+
+	private:
+		AsyncFileIo (const AsyncFileIo &);
+		AsyncFileIo &operator= (const AsyncFileIo &);
+	};
+}
+
+#endif // TC_HEADER_Platform_AsyncFileIo
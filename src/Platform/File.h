@@ -69,6 +69,7 @@ namespace VeraCrypt
 		void Close ();
 		static void Copy (const FilePath &sourcePath, const FilePath &destinationPath, bool preserveTimestamps = true);
 		void Delete ();
+		void Discard (uint64 position, uint64 length) const; // Deallocates the range of a file or device, which is read as zeros afterwards
 		void Flush () const;
 		uint32 GetDeviceSectorSize () const;
 		static size_t GetOptimalReadSize () { return OptimalReadSize; }
@@ -76,6 +77,7 @@ namespace VeraCrypt
 		uint64 GetPartitionDeviceStartOffset () const;
 		bool IsOpen () const { return FileIsOpen; }
 		FilePath GetPath () const;
+		SystemFileHandleType GetSystemHandle () const { return FileHandle; }
 		uint64 Length () const;
 		void Open (const FilePath &path, FileOpenMode mode = OpenRead, FileShareMode shareMode = ShareReadWrite, FileOpenFlags flags = FlagsNone);
 		uint64 Read (const BufferPtr &buffer) const;
@@ -83,6 +85,7 @@ namespace VeraCrypt
 		uint64 ReadAt (const BufferPtr &buffer, uint64 position) const;
 		void SeekAt (uint64 position) const;
 		void SeekEnd (int ofset) const;
+		void SetDirectIo (bool enable); // Requests bypass the system cache and must be aligned to the logical block size
 		void Write (const ConstBufferPtr &buffer) const;
 		void Write (const ConstBufferPtr &buffer, size_t length) const { Write (buffer.GetRange (0, length)); }
 		void WriteAt (const ConstBufferPtr &buffer, uint64 position) const;
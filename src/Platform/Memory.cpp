@@ -67,6 +67,14 @@ namespace VeraCrypt
 		burn (memory, size);
 	}
 
+	bool Memory::IsZero (const void *memory, size_t size)
+	{
+		const byte *bytes = static_cast <const byte *> (memory);
+
+		// Each byte is compared with its successor once the first one is known to be zero
+		return size == 0 || (bytes[0] == 0 && memcmp (bytes, bytes + 1, size - 1) == 0);
+	}
+
 	void Memory::Zero (void *memory, size_t size)
 	{
 		memset (memory, 0, size);
@@ -79,6 +79,7 @@ namespace VeraCrypt
 		static void Erase (void *memory, size_t size);
 		static void Free (void *memory);
 		static void FreeAligned (void *memory);
+		static bool IsZero (const void *memory, size_t size);
 		static void Zero (void *memory, size_t size);
 	};
 
@@ -0,0 +1,480 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#ifdef TC_LINUX
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#	if defined (__NR_io_uring_setup) && defined (__NR_io_uring_enter) && defined (__NR_io_uring_register)
+#		include <linux/io_uring.h>
+#		define TC_IO_URING
+#	endif
+#endif
+
+#include "Platform/AsyncFileIo.h"
+#include "Platform/Memory.h"
+#include "Platform/SystemException.h"
+#include "Platform/Thread.h"
+
+namespace VeraCrypt
+{
+	AsyncFileIo::AsyncFileIo (shared_ptr <File> file, size_t queueDepth)
+		: IoFile (file), QueueDepth (queueDepth), QueuedCount (0), Requests (queueDepth), SubmittedCount (0),
+		RingFd (-1), SubmissionRing (nullptr), SubmissionRingSize (0), CompletionRing (nullptr), CompletionRingSize (0),
+		SubmissionEntries (nullptr), SubmissionEntriesSize (0), SubmissionHead (nullptr), SubmissionTail (nullptr), SubmissionMask (0),
+		SubmissionArray (nullptr), CompletionHead (nullptr), CompletionTail (nullptr), CompletionMask (0), TimedCompletionTail (0),
+		CompletionEntries (nullptr), IoVectors (nullptr)
+	{
+		if (queueDepth < 1)
+			throw ParameterIncorrect (SRC_POS);
+
+		for (size_t i = 0; i < queueDepth; ++i)
+			FreeSlots.push_back (i);
+
+		if (IsSupported())
+			SetupRing();
+	}
+
+	AsyncFileIo::~AsyncFileIo ()
+	{
+		Drain();
+		CloseRing();
+	}
+
+	void AsyncFileIo::CloseRing ()
+	{
+#ifdef TC_IO_URING
+		if (SubmissionEntries)
+			munmap (SubmissionEntries, SubmissionEntriesSize);
+
+		if (CompletionRing && CompletionRing != SubmissionRing)
+			munmap (CompletionRing, CompletionRingSize);
+
+		if (SubmissionRing)
+			munmap (SubmissionRing, SubmissionRingSize);
+
+		if (RingFd != -1)
+			close (RingFd);
+
+		delete[] static_cast <struct iovec *> (IoVectors);
+#endif
+		SubmissionEntries = nullptr;
+		CompletionRing = nullptr;
+		SubmissionRing = nullptr;
+		RingFd = -1;
+		IoVectors = nullptr;
+	}
+
+	size_t AsyncFileIo::CompleteRequest (const Request &request, ssize_t result) const
+	{
+		if (result < 0)
+			throw SystemException (SRC_POS, -result);
+
+		size_t done = static_cast <size_t> (result);
+
+		while (done < request.Size)
+		{
+			ssize_t r;
+			if (request.Write)
+				r = pwrite (IoFile->GetSystemHandle(), request.Buffer + done, request.Size - done, request.Position + done);
+			else
+				r = pread (IoFile->GetSystemHandle(), request.Buffer + done, request.Size - done, request.Position + done);
+
+			if (r == -1 && errno == EINTR)
+				continue;
+
+			throw_sys_sub_if (r == -1, wstring (IoFile->GetPath()));
+
+			if (r == 0)
+			{
+				if (request.Write)
+					throw SystemException (SRC_POS, EIO);
+				break;
+			}
+
+			done += static_cast <size_t> (r);
+		}
+
+		return done;
+	}
+
+	void AsyncFileIo::Drain ()
+	{
+		int failedAttempts = 0;
+
+		while (GetPendingCount() > 0)
+		{
+			size_t pendingCount = GetPendingCount();
+
+			try
+			{
+				if (QueuedCount > 0)
+					Submit();
+
+				WaitForCompletion();
+			}
+			catch (...)
+			{
+				// Failed requests are completed; a ring that keeps failing to submit or reap is abandoned
+				if (GetPendingCount() < pendingCount)
+					failedAttempts = 0;
+				else if (++failedAttempts >= MaxDrainAttempts)
+					AbandonRequests();
+			}
+		}
+	}
+
+	void AsyncFileIo::AbandonRequests ()
+	{
+#ifdef TC_IO_URING
+		if (RingFd != -1 && SubmittedCount > 0)
+		{
+			// Requests in flight are cancelled asynchronously and may access their buffers until they complete.
+			// Cancellations are submitted only if no other entry is waiting in the submission ring.
+			if (QueuedCount == 0)
+			{
+				vector <bool> inFlight (QueueDepth, true);
+				foreach (size_t slot, FreeSlots)
+					inFlight[slot] = false;
+
+				uint32 tail = *SubmissionTail;
+				unsigned int cancelCount = 0;
+
+				for (size_t slot = 0; slot < QueueDepth; ++slot)
+				{
+					if (!inFlight[slot])
+						continue;
+
+					uint32 index = tail & SubmissionMask;
+					struct io_uring_sqe *entry = reinterpret_cast <struct io_uring_sqe *> (SubmissionEntries) + index;
+					Memory::Zero (entry, sizeof (*entry));
+
+					entry->opcode = IORING_OP_ASYNC_CANCEL;
+					entry->fd = -1;
+					entry->addr = slot;
+					entry->user_data = CancelRequestData;
+
+					SubmissionArray[index] = index;
+					++tail;
+					++cancelCount;
+				}
+
+				__atomic_store_n (SubmissionTail, tail, __ATOMIC_RELEASE);
+				syscall (__NR_io_uring_enter, RingFd, cancelCount, 0, 0, nullptr, 0);
+			}
+
+			// Completions are posted to the ring even if entering the kernel keeps failing
+			uint32 head = *CompletionHead;
+			while (SubmittedCount > 0)
+			{
+				if (head == __atomic_load_n (CompletionTail, __ATOMIC_ACQUIRE))
+				{
+					if (syscall (__NR_io_uring_enter, RingFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) == -1)
+						Thread::Sleep (1);
+					continue;
+				}
+
+				const struct io_uring_cqe *entry = reinterpret_cast <const struct io_uring_cqe *> (CompletionEntries) + (head & CompletionMask);
+				if (entry->user_data != CancelRequestData)
+					--SubmittedCount;
+
+				__atomic_store_n (CompletionHead, ++head, __ATOMIC_RELEASE);
+			}
+		}
+#endif
+		CloseRing();
+
+		QueuedCount = 0;
+		SubmittedCount = 0;
+		CompletedSlots.clear();
+		FreeSlots.clear();
+
+		for (size_t i = 0; i < QueueDepth; ++i)
+			FreeSlots.push_back (i);
+	}
+
+	uint64 AsyncFileIo::GetTime ()
+	{
+		struct timespec now;
+		throw_sys_if (clock_gettime (CLOCK_MONOTONIC, &now) == -1);
+
+		return static_cast <uint64> (now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+	}
+
+	bool AsyncFileIo::IsSupported ()
+	{
+		if (Supported == -1)
+		{
+#ifdef TC_IO_URING
+			struct io_uring_params params;
+			Memory::Zero (&params, sizeof (params));
+
+			int fd = static_cast <int> (syscall (__NR_io_uring_setup, 1U, &params));
+			if (fd != -1)
+				close (fd);
+
+			Supported = (fd != -1) ? 1 : 0;
+#else
+			Supported = 0;
+#endif
+		}
+
+		return Supported == 1;
+	}
+
+	void AsyncFileIo::Queue (byte *buffer, size_t size, uint64 position, uint64 requestId, bool write)
+	{
+		if (FreeSlots.empty())
+			throw ParameterIncorrect (SRC_POS);
+
+		TimeCompletions();
+
+		size_t slot = FreeSlots.front();
+		FreeSlots.pop_front();
+
+		Request &request = Requests[slot];
+		request.Buffer = buffer;
+		request.CompletionTime = 0;
+		request.Id = requestId;
+		request.Position = position;
+		request.QueueTime = GetTime();
+		request.Size = size;
+		request.Write = write;
+
+		++QueuedCount;
+
+#ifdef TC_IO_URING
+		if (RingFd != -1)
+		{
+			struct iovec &ioVector = static_cast <struct iovec *> (IoVectors)[slot];
+			ioVector.iov_base = buffer;
+			ioVector.iov_len = size;
+
+			uint32 tail = *SubmissionTail;
+			uint32 index = tail & SubmissionMask;
+
+			struct io_uring_sqe *entry = reinterpret_cast <struct io_uring_sqe *> (SubmissionEntries) + index;
+			Memory::Zero (entry, sizeof (*entry));
+
+			// Vectored requests are supported by all kernels providing io_uring
+			entry->opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+			entry->flags = IOSQE_FIXED_FILE;
+			entry->fd = 0;
+			entry->off = position;
+			entry->addr = reinterpret_cast <uint64> (&ioVector);
+			entry->len = 1;
+			entry->user_data = slot;
+
+			SubmissionArray[index] = index;
+			__atomic_store_n (SubmissionTail, tail + 1, __ATOMIC_RELEASE);
+			return;
+		}
+#endif
+		// Performed synchronously when submitted
+		CompletedSlots.push_back (slot);
+	}
+
+	void AsyncFileIo::QueueRead (const BufferPtr &buffer, uint64 position, uint64 requestId)
+	{
+		Queue (buffer.Get(), buffer.Size(), position, requestId, false);
+	}
+
+	void AsyncFileIo::QueueWrite (const ConstBufferPtr &buffer, uint64 position, uint64 requestId)
+	{
+		Queue (const_cast <byte *> (buffer.Get()), buffer.Size(), position, requestId, true);
+	}
+
+	bool AsyncFileIo::SetupRing ()
+	{
+#ifdef TC_IO_URING
+		struct io_uring_params params;
+		Memory::Zero (&params, sizeof (params));
+
+		RingFd = static_cast <int> (syscall (__NR_io_uring_setup, static_cast <unsigned int> (QueueDepth), &params));
+		if (RingFd == -1)
+			return false;
+
+		SubmissionRingSize = params.sq_off.array + params.sq_entries * sizeof (uint32);
+		CompletionRingSize = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+
+		if (params.features & IORING_FEAT_SINGLE_MMAP)
+			SubmissionRingSize = CompletionRingSize = max (SubmissionRingSize, CompletionRingSize);
+
+		void *ring = mmap (nullptr, SubmissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFd, IORING_OFF_SQ_RING);
+		if (ring == MAP_FAILED)
+		{
+			CloseRing();
+			return false;
+		}
+		SubmissionRing = static_cast <byte *> (ring);
+
+		if (params.features & IORING_FEAT_SINGLE_MMAP)
+			CompletionRing = SubmissionRing;
+		else
+		{
+			ring = mmap (nullptr, CompletionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFd, IORING_OFF_CQ_RING);
+			if (ring == MAP_FAILED)
+			{
+				CloseRing();
+				return false;
+			}
+			CompletionRing = static_cast <byte *> (ring);
+		}
+
+		SubmissionEntriesSize = params.sq_entries * sizeof (struct io_uring_sqe);
+		ring = mmap (nullptr, SubmissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFd, IORING_OFF_SQES);
+		if (ring == MAP_FAILED)
+		{
+			CloseRing();
+			return false;
+		}
+		SubmissionEntries = static_cast <byte *> (ring);
+
+		SubmissionHead = reinterpret_cast <uint32 *> (SubmissionRing + params.sq_off.head);
+		SubmissionTail = reinterpret_cast <uint32 *> (SubmissionRing + params.sq_off.tail);
+		SubmissionMask = *reinterpret_cast <uint32 *> (SubmissionRing + params.sq_off.ring_mask);
+		SubmissionArray = reinterpret_cast <uint32 *> (SubmissionRing + params.sq_off.array);
+		CompletionHead = reinterpret_cast <uint32 *> (CompletionRing + params.cq_off.head);
+		CompletionTail = reinterpret_cast <uint32 *> (CompletionRing + params.cq_off.tail);
+		CompletionMask = *reinterpret_cast <uint32 *> (CompletionRing + params.cq_off.ring_mask);
+		CompletionEntries = CompletionRing + params.cq_off.cqes;
+		TimedCompletionTail = *CompletionTail;
+
+		// The file descriptor is registered to avoid looking it up for each request
+		int fd = IoFile->GetSystemHandle();
+		if (syscall (__NR_io_uring_register, RingFd, IORING_REGISTER_FILES, &fd, 1) == -1)
+		{
+			CloseRing();
+			return false;
+		}
+
+		IoVectors = new struct iovec[QueueDepth];
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void AsyncFileIo::Submit ()
+	{
+		if (QueuedCount == 0)
+			return;
+
+#ifdef TC_IO_URING
+		if (RingFd != -1)
+		{
+			while (QueuedCount > 0)
+			{
+				int submitted = static_cast <int> (syscall (__NR_io_uring_enter, RingFd, static_cast <unsigned int> (QueuedCount), 0, 0, nullptr, 0));
+
+				if (submitted == -1 && (errno == EINTR || errno == EAGAIN))
+					continue;
+
+				throw_sys_if (submitted == -1);
+
+				QueuedCount -= submitted;
+				SubmittedCount += submitted;
+			}
+
+			// Requests served from the system cache are usually completed by the submission
+			TimeCompletions();
+			return;
+		}
+#endif
+		SubmittedCount += QueuedCount;
+		QueuedCount = 0;
+	}
+
+	void AsyncFileIo::TimeCompletions ()
+	{
+#ifdef TC_IO_URING
+		if (RingFd == -1)
+			return;
+
+		uint32 tail = __atomic_load_n (CompletionTail, __ATOMIC_ACQUIRE);
+		if (tail == TimedCompletionTail)
+			return;
+
+		uint64 time = GetTime();
+
+		for (; TimedCompletionTail != tail; ++TimedCompletionTail)
+		{
+			const struct io_uring_cqe *entry = reinterpret_cast <const struct io_uring_cqe *> (CompletionEntries) + (TimedCompletionTail & CompletionMask);
+			Requests[static_cast <size_t> (entry->user_data)].CompletionTime = time;
+		}
+#endif
+	}
+
+	uint64 AsyncFileIo::WaitForCompletion (size_t *transferredSize, uint64 *latency)
+	{
+		if (SubmittedCount == 0)
+			throw ParameterIncorrect (SRC_POS);
+
+		size_t slot;
+		ssize_t result;
+
+#ifdef TC_IO_URING
+		if (RingFd != -1)
+		{
+			uint32 head = *CompletionHead;
+
+			while (head == __atomic_load_n (CompletionTail, __ATOMIC_ACQUIRE))
+			{
+				if (syscall (__NR_io_uring_enter, RingFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) == -1 && errno != EINTR)
+					throw SystemException (SRC_POS);
+			}
+
+			TimeCompletions();
+
+			const struct io_uring_cqe *entry = reinterpret_cast <const struct io_uring_cqe *> (CompletionEntries) + (head & CompletionMask);
+			slot = static_cast <size_t> (entry->user_data);
+			result = entry->res;
+
+			__atomic_store_n (CompletionHead, head + 1, __ATOMIC_RELEASE);
+		}
+		else
+#endif
+		{
+			slot = CompletedSlots.front();
+			CompletedSlots.pop_front();
+			result = 0;
+		}
+
+		--SubmittedCount;
+		FreeSlots.push_back (slot);
+
+		const Request &request = Requests[slot];
+
+		// Requests performed synchronously and remainders of short transfers are timed here
+		uint64 startTime = latency ? GetTime() : 0;
+		size_t transferred = CompleteRequest (request, result);
+
+		if (transferredSize)
+			*transferredSize = transferred;
+
+		if (latency)
+		{
+			*latency = GetTime() - startTime;
+
+			if (request.CompletionTime != 0)
+				*latency += request.CompletionTime - request.QueueTime;
+		}
+
+		return request.Id;
+	}
+
+	int AsyncFileIo::Supported = -1;
+}
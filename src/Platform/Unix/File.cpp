@@ -88,6 +88,18 @@ namespace VeraCrypt
 	}
 
 
+	void File::Discard (uint64 position, uint64 length) const
+	{
+		if_debug (ValidateState());
+
+#ifdef TC_LINUX
+		// Punched ranges of block devices are unmapped only if the device guarantees to read them as zeros (BLKDISCARD does not)
+		throw_sys_sub_if (fallocate (FileHandle, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, position, length) == -1, wstring (Path));
+#else
+		throw NotImplemented (SRC_POS);
+#endif
+	}
+
 	void File::Flush () const
 	{
 		if_debug (ValidateState());
@@ -330,6 +342,22 @@ namespace VeraCrypt
 		throw_sys_sub_if (lseek (FileHandle, offset, SEEK_END) == -1, wstring (Path));
 	}
 
+	void File::SetDirectIo (bool enable)
+	{
+		if_debug (ValidateState());
+
+#ifdef O_DIRECT
+		int flags = fcntl (FileHandle, F_GETFL);
+		throw_sys_sub_if (flags == -1, wstring (Path));
+
+		flags = enable ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+		throw_sys_sub_if (fcntl (FileHandle, F_SETFL, flags) == -1, wstring (Path));
+#else
+		if (enable)
+			throw NotImplemented (SRC_POS);
+#endif
+	}
+
 	void File::Write (const ConstBufferPtr &buffer) const
 	{
 		if_debug (ValidateState());
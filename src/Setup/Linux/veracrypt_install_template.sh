@@ -1031,7 +1031,7 @@ fi
 
 if [ "$PACKAGE_TYPE" = "tar" ]
 then
-	if ! which fusermount >/dev/null 2>/dev/null || ! which dmsetup >/dev/null 2>/dev/null
+	if ! which fusermount3 >/dev/null 2>/dev/null || ! which dmsetup >/dev/null 2>/dev/null
 	then
 		show_message "$(cat <<_INFO
 Requirements for Running VeraCrypt:
@@ -10,14 +10,21 @@
  code distribution packages.
 */
 
+#include <stdlib.h>
+#include <unistd.h>
 #include "Cipher.h"
 #include "Common/Crc.h"
+#include "Crypto/Argon2.h"
 #include "Crc32.h"
 #include "EncryptionAlgorithm.h"
 #include "EncryptionMode.h"
 #include "EncryptionModeXTS.h"
 #include "EncryptionTest.h"
 #include "Pkcs5Kdf.h"
+#include "Volume.h"
+#include "VolumeLayout.h"
+#include "VolumeSectorCache.h"
+#include "VolumeWriteBack.h"
 
 namespace VeraCrypt
 {
@@ -25,6 +32,9 @@ namespace VeraCrypt
 	{
 		TestAll (false);
 		TestAll (true);
+
+		TestVolumeSectorCache();
+		TestVolumeWriteBack();
 	}
 
 	void EncryptionTest::TestAll (bool enableCpuEncryptionSupport)
@@ -1156,5 +1166,246 @@ namespace VeraCrypt
 		pkcs5HmacStreebog.DeriveKey (derivedKey, password, salt, 5);
 		if (memcmp (derivedKey.Ptr(), "\xd0\x53\xa2\x30", 4) != 0)
 			throw TestFailed (SRC_POS);
+
+		// Argon2id test vector from RFC 9106
+		byte argon2Password[32], argon2Salt[16], argon2Secret[8], argon2Ad[12], argon2Tag[32];
+		memset (argon2Password, 0x01, sizeof (argon2Password));
+		memset (argon2Salt, 0x02, sizeof (argon2Salt));
+		memset (argon2Secret, 0x03, sizeof (argon2Secret));
+		memset (argon2Ad, 0x04, sizeof (argon2Ad));
+
+		if (!argon2id_hash (argon2Password, sizeof (argon2Password), argon2Salt, sizeof (argon2Salt), argon2Secret, sizeof (argon2Secret),
+			argon2Ad, sizeof (argon2Ad), 3, 32, 4, argon2Tag, sizeof (argon2Tag)))
+		{
+			throw TestFailed (SRC_POS);
+		}
+
+		if (memcmp (argon2Tag, "\x0d\x64\x0d\xf5\x8d\x78\x76\x6c\x08\xc0\x37\xa3\x4a\x8b\x53\xc9\xd0\x1e\xf0\x45\x2d\x75\xb6\x5e\xb5\x25\x20\xe9\x6b\x01\xe6\x59", 32) != 0)
+			throw TestFailed (SRC_POS);
+
+		// Lanes filled by worker threads must produce the same key as the single-threaded reference
+		static const byte argon2KdfSaltData[] = { 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0 };
+		Argon2idKdf argon2idKdf;
+		argon2idKdf.DeriveKey (derivedKey, password, ConstBufferPtr (argon2KdfSaltData, sizeof (argon2KdfSaltData)), 1);
+		if (memcmp (derivedKey.Ptr(), "\x9c\xcc\x17\x15", 4) != 0)
+			throw TestFailed (SRC_POS);
+	}
+
+	namespace
+	{
+		// Volume hosted by a temporary file, which is deleted when the volume is destroyed
+		class TestVolume : public Volume
+		{
+		public:
+			TestVolume (uint64 dataSize)
+			{
+				const char *tempDir = getenv ("TMPDIR");
+				string pathTemplate = string (tempDir ? tempDir : "/tmp") + "/veracrypt_test_XXXXXX";
+
+				vector <char> path (pathTemplate.begin(), pathTemplate.end());
+				path.push_back (0);
+
+				int fd = mkstemp (&path[0]);
+				throw_sys_if (fd == -1);
+				close (fd);
+
+				HostPath = FilesystemPath (&path[0]);
+
+				try
+				{
+					Create (dataSize);
+				}
+				catch (...)
+				{
+					HostPath.Delete();
+					throw;
+				}
+			}
+
+			virtual ~TestVolume ()
+			{
+				try
+				{
+					Close();
+					HostPath.Delete();
+				}
+				catch (...) { }
+			}
+
+		protected:
+			void Create (uint64 dataSize)
+			{
+				VolumeLayoutV2Normal layout;
+				uint64 hostSize = dataSize + TC_TOTAL_VOLUME_HEADERS_SIZE;
+
+				shared_ptr <File> hostFile (new File);
+				hostFile->Open (HostPath, File::OpenReadWrite);
+
+				SecureBuffer zeroData (hostSize);
+				zeroData.Zero();
+				hostFile->Write (zeroData);
+
+				shared_ptr <EncryptionAlgorithm> ea (new AES);
+				shared_ptr <Pkcs5Kdf> kdf (new Pkcs5HmacSha512 (false));
+				shared_ptr <VolumePassword> password (new VolumePassword ((const byte *) "password", 8));
+
+				SecureBuffer dataKey (ea->GetKeySize() * 2);
+				SecureBuffer salt (VolumeHeader::GetSaltSize());
+				for (size_t i = 0; i < dataKey.Size(); ++i)
+					dataKey[i] = (byte) (i * 13 + 1);
+				for (size_t i = 0; i < salt.Size(); ++i)
+					salt[i] = (byte) (i * 7 + 5);
+
+				SecureBuffer headerKey (VolumeHeader::GetLargestSerializedKeySize());
+				kdf->DeriveKey (headerKey, *password, TestPim, salt);
+
+				VolumeHeaderCreationOptions options;
+				options.DataKey = dataKey;
+				options.EA = ea;
+				options.HeaderKey = headerKey;
+				options.Kdf = kdf;
+				options.Salt = salt;
+				options.SectorSize = TC_SECTOR_SIZE_FILE_HOSTED_VOLUME;
+				options.Type = VolumeType::Normal;
+				options.VolumeDataSize = layout.GetMaxDataSize (hostSize);
+				options.VolumeDataStart = layout.GetHeaderSize() * 2;
+
+				SecureBuffer header (layout.GetHeaderSize());
+				layout.GetHeader()->Create (header, options);
+				hostFile->WriteAt (header, 0);
+				hostFile->WriteAt (header, hostSize + layout.GetBackupHeaderOffset());
+
+				Open (hostFile, password, TestPim, kdf, false, shared_ptr <KeyfileList> (), VolumeProtection::None,
+					shared_ptr <VolumePassword> (), 0, shared_ptr <Pkcs5Kdf> (), shared_ptr <KeyfileList> (), VolumeType::Normal);
+			}
+
+			FilesystemPath HostPath;
+			static const int TestPim = 1;
+		};
+
+		// Invalidates cached sectors when buffered writes reach the volume
+		struct TestWriteBackHandler
+		{
+			TestWriteBackHandler (VolumeSectorCache &cache) : Cache (cache) { }
+
+			void OnSectorsWritten (EventArgs &args)
+			{
+				VolumeSectorsWrittenEventArgs &written = dynamic_cast <VolumeSectorsWrittenEventArgs &> (args);
+				Cache.Invalidate (written.ByteOffset, written.Size);
+			}
+
+			VolumeSectorCache &Cache;
+		};
+
+		void FillTestData (const BufferPtr &buffer, byte seed)
+		{
+			for (size_t i = 0; i < buffer.Size(); ++i)
+				buffer[i] = (byte) (i * 31 + seed);
+		}
+	}
+
+	void EncryptionTest::TestVolumeSectorCache ()
+	{
+		TestVolume volume (512 * 1024);
+		VolumeSectorCache cache (2 * 1024 * 1024);
+
+		SecureBuffer data ((size_t) volume.GetSize());
+		FillTestData (data, 7);
+		volume.WriteSectors (data, 0);
+
+		SecureBuffer readData (data.Size());
+		cache.ReadSectors (volume, readData, 0);
+		if (memcmp (readData.Ptr(), data.Ptr(), data.Size()) != 0 || cache.GetMissCount() == 0)
+			throw TestFailed (SRC_POS);
+
+		uint64 missCount = cache.GetMissCount();
+		readData.Zero();
+		cache.ReadSectors (volume, readData, 0);
+		if (memcmp (readData.Ptr(), data.Ptr(), data.Size()) != 0 || cache.GetMissCount() != missCount || cache.GetHitCount() == 0)
+			throw TestFailed (SRC_POS);
+
+		// Sectors written across a block boundary must be read from the volume once they have been invalidated
+		uint64 writeOffset = VolumeSectorCache::BlockSize - 2 * ENCRYPTION_DATA_UNIT_SIZE;
+		SecureBuffer writeData (4 * ENCRYPTION_DATA_UNIT_SIZE);
+		FillTestData (writeData, 101);
+
+		volume.WriteSectors (writeData, writeOffset);
+		cache.Invalidate (writeOffset, writeData.Size());
+		data.GetRange ((size_t) writeOffset, writeData.Size()).CopyFrom (writeData);
+
+		readData.Zero();
+		cache.ReadSectors (volume, readData, 0);
+		if (memcmp (readData.Ptr(), data.Ptr(), data.Size()) != 0 || cache.GetMissCount() == missCount)
+			throw TestFailed (SRC_POS);
+
+		BufferPtr partialData = readData.GetRange (0, writeData.Size());
+		cache.ReadSectors (volume, partialData, writeOffset);
+		if (memcmp (partialData.Get(), writeData.Ptr(), writeData.Size()) != 0)
+			throw TestFailed (SRC_POS);
+
+		// Blocks outside of an invalidated range remain cached
+		missCount = cache.GetMissCount();
+		cache.Invalidate (0, ENCRYPTION_DATA_UNIT_SIZE);
+		cache.ReadSectors (volume, readData.GetRange (0, VolumeSectorCache::BlockSize), VolumeSectorCache::BlockSize);
+		if (cache.GetMissCount() != missCount)
+			throw TestFailed (SRC_POS);
+	}
+
+	void EncryptionTest::TestVolumeWriteBack ()
+	{
+		TestVolume volume (512 * 1024);
+		VolumeSectorCache cache (2 * 1024 * 1024);
+
+		SecureBuffer data ((size_t) volume.GetSize());
+		FillTestData (data, 7);
+		volume.WriteSectors (data, 0);
+
+		SecureBuffer readData (data.Size());
+		cache.ReadSectors (volume, readData, 0);
+
+		TestWriteBackHandler handler (cache);
+		VolumeWriteBack writeBack (volume, 1024 * 1024);
+		writeBack.SectorsWrittenEvent.Connect (EventConnector <TestWriteBackHandler> (&handler, &TestWriteBackHandler::OnSectorsWritten));
+
+		// Buffered writes are applied to data read before they reach the volume
+		SecureBuffer firstWrite (16 * ENCRYPTION_DATA_UNIT_SIZE);
+		FillTestData (firstWrite, 101);
+		writeBack.Write (firstWrite, 8 * ENCRYPTION_DATA_UNIT_SIZE);
+		data.GetRange (8 * ENCRYPTION_DATA_UNIT_SIZE, firstWrite.Size()).CopyFrom (firstWrite);
+
+		SecureBuffer secondWrite (16 * ENCRYPTION_DATA_UNIT_SIZE);
+		FillTestData (secondWrite, 203);
+		writeBack.Write (secondWrite, 16 * ENCRYPTION_DATA_UNIT_SIZE);
+		data.GetRange (16 * ENCRYPTION_DATA_UNIT_SIZE, secondWrite.Size()).CopyFrom (secondWrite);
+
+		VolumeWriteBack::PendingWriteList pendingWrites;
+		writeBack.GetPendingWrites (0, readData.Size(), pendingWrites);
+
+		readData.Zero();
+		cache.ReadSectors (volume, readData, 0);
+		VolumeWriteBack::ApplyPendingWrites (pendingWrites, readData, 0);
+
+		if (memcmp (readData.Ptr(), data.Ptr(), data.Size()) != 0)
+			throw TestFailed (SRC_POS);
+
+		// Flushed writes are merged in the order of submission and reach the volume and the cache
+		writeBack.Flush (false);
+
+		pendingWrites.clear();
+		writeBack.GetPendingWrites (0, readData.Size(), pendingWrites);
+		if (!pendingWrites.empty())
+			throw TestFailed (SRC_POS);
+
+		readData.Zero();
+		volume.ReadSectors (readData, 0);
+		if (memcmp (readData.Ptr(), data.Ptr(), data.Size()) != 0)
+			throw TestFailed (SRC_POS);
+
+		readData.Zero();
+		cache.ReadSectors (volume, readData, 0);
+		if (memcmp (readData.Ptr(), data.Ptr(), data.Size()) != 0)
+			throw TestFailed (SRC_POS);
+
+		writeBack.Stop();
 	}
 }
@@ -28,6 +28,8 @@ namespace VeraCrypt
 		static void TestCiphers ();
 		static void TestLegacyModes ();
 		static void TestPkcs5 ();
+		static void TestVolumeSectorCache ();
+		static void TestVolumeWriteBack ();
 		static void TestXts ();
 		static void TestXtsAES ();
 
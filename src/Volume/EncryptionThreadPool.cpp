@@ -26,6 +26,61 @@
 
 namespace VeraCrypt
 {
+	void EncryptionThreadPool::BeginKeyDerivation (PendingKeyDerivation &pending, const Pkcs5Kdf &kdf, const VolumePassword &password, int pim, const ConstBufferPtr &salt, const BufferPtr &key)
+	{
+		if (pending.Pending)
+			throw ParameterIncorrect (SRC_POS);
+
+		pending.DerivationException.reset();
+		pending.Pending = true;
+
+		if (ThreadPoolRunning)
+		{
+			// The pool may have been stopped while waiting for the lock
+			ScopeLock lock (EnqueueMutex);
+
+			if (ThreadPoolRunning)
+			{
+				WorkItem *workItem = &WorkItemQueue[EnqueuePosition++];
+
+				if (EnqueuePosition >= QueueSize)
+					EnqueuePosition = 0;
+
+				while (workItem->State != WorkItem::State::Free)
+				{
+					WorkItemCompletedEvent.Wait();
+				}
+
+				workItem->Type = WorkType::DeriveKey;
+				workItem->FirstFragment = workItem;
+
+				workItem->KeyDerivation.Kdf = &kdf;
+				workItem->KeyDerivation.Password = &password;
+				workItem->KeyDerivation.Pim = pim;
+				workItem->KeyDerivation.Salt = salt.Get();
+				workItem->KeyDerivation.SaltSize = salt.Size();
+				workItem->KeyDerivation.Key = key.Get();
+				workItem->KeyDerivation.KeySize = key.Size();
+				workItem->KeyDerivation.Pending = &pending;
+
+				workItem->State.Set (WorkItem::State::Ready);
+				WorkItemReadyEvent.Signal();
+				return;
+			}
+		}
+
+		try
+		{
+			kdf.DeriveKey (key, password, pim, salt);
+		}
+		catch (Exception &e)
+		{
+			pending.DerivationException.reset (e.CloneNew());
+		}
+
+		pending.DerivationCompletedEvent.Signal();
+	}
+
 	void EncryptionThreadPool::DoWork (WorkType::Enum type, const EncryptionMode *encryptionMode, byte *data, uint64 startUnitNo, uint64 unitCount, size_t sectorSize)
 	{
 		size_t fragmentCount;
@@ -136,11 +191,42 @@ namespace VeraCrypt
 			itemException->Throw();
 	}
 
-	void EncryptionThreadPool::Start ()
+	void EncryptionThreadPool::EndKeyDerivation (PendingKeyDerivation &pending)
 	{
-		if (ThreadPoolRunning)
+		if (!pending.Pending)
 			return;
 
+		pending.DerivationCompletedEvent.Wait();
+		pending.Pending = false;
+
+		if (pending.DerivationException.get())
+		{
+			auto_ptr <Exception> derivationException (pending.DerivationException);
+			derivationException->Throw();
+		}
+	}
+
+	void EncryptionThreadPool::FailPendingKeyDerivations ()
+	{
+		for (size_t i = 0; i < QueueSize; ++i)
+		{
+			WorkItem *workItem = &WorkItemQueue[i];
+
+			if (workItem->State == WorkItem::State::Ready && workItem->Type == WorkType::DeriveKey)
+			{
+				PendingKeyDerivation *pending = workItem->KeyDerivation.Pending;
+				pending->DerivationException.reset (new UserAbort (SRC_POS));
+
+				workItem->State.Set (WorkItem::State::Free);
+				WorkItemCompletedEvent.Signal();
+
+				pending->DerivationCompletedEvent.Signal();
+			}
+		}
+	}
+
+	size_t EncryptionThreadPool::GetCpuCount ()
+	{
 		size_t cpuCount;
 
 #ifdef TC_WINDOWS
@@ -170,6 +256,16 @@ namespace VeraCrypt
 #	error Cannot determine CPU count
 #endif
 
+		return cpuCount;
+	}
+
+	void EncryptionThreadPool::Start ()
+	{
+		if (ThreadPoolRunning)
+			return;
+
+		size_t cpuCount = GetCpuCount();
+
 		if (cpuCount < 2)
 			return;
 
@@ -229,6 +325,13 @@ namespace VeraCrypt
 			thread.Join();
 		}
 
+		// Key derivations left in the queue fail so that EndKeyDerivation() does not wait for them forever.
+		// They are released once without the lock as an issuer may hold it while waiting for a free entry.
+		FailPendingKeyDerivations();
+
+		ScopeLock lock (EnqueueMutex);
+		FailPendingKeyDerivations();
+
 		ThreadCount = 0;
 		ThreadPoolRunning = false;
 	}
@@ -254,11 +357,43 @@ namespace VeraCrypt
 						WorkItemReadyEvent.Wait();
 					}
 
+					// Items not taken before stopping are left to Stop()
+					if (StopPending)
+						break;
+
 					workItem->State.Set (WorkItem::State::Busy);
 				}
 
-				if (StopPending)
-					break;
+				if (workItem->Type == WorkType::DeriveKey)
+				{
+					// Key derivation items are released before completion is signaled so that
+					// issuers never hold queue entries
+					PendingKeyDerivation *pending = workItem->KeyDerivation.Pending;
+
+					try
+					{
+						workItem->KeyDerivation.Kdf->DeriveKey (BufferPtr (workItem->KeyDerivation.Key, workItem->KeyDerivation.KeySize), *workItem->KeyDerivation.Password,
+							workItem->KeyDerivation.Pim, ConstBufferPtr (workItem->KeyDerivation.Salt, workItem->KeyDerivation.SaltSize));
+					}
+					catch (Exception &e)
+					{
+						pending->DerivationException.reset (e.CloneNew());
+					}
+					catch (exception &e)
+					{
+						pending->DerivationException.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
+					}
+					catch (...)
+					{
+						pending->DerivationException.reset (new UnknownException (SRC_POS));
+					}
+
+					workItem->State.Set (WorkItem::State::Free);
+					WorkItemCompletedEvent.Signal();
+
+					pending->DerivationCompletedEvent.Signal();
+					continue;
+				}
 
 				try
 				{
@@ -272,6 +407,7 @@ namespace VeraCrypt
 						workItem->Encryption.Mode->EncryptSectorsCurrentThread (workItem->Encryption.Data, workItem->Encryption.StartUnitNo, workItem->Encryption.UnitCount, workItem->Encryption.SectorSize);
 						break;
 
+
 					default:
 						throw ParameterIncorrect (SRC_POS);
 					}
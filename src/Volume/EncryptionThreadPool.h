@@ -15,12 +15,26 @@
 
 #include "Platform/Platform.h"
 #include "EncryptionMode.h"
+#include "Pkcs5Kdf.h"
 
 namespace VeraCrypt
 {
 	class EncryptionThreadPool
 	{
 	public:
+		struct PendingKeyDerivation
+		{
+			PendingKeyDerivation () : Pending (false) { }
+
+			auto_ptr <Exception> DerivationException;
+			SyncEvent DerivationCompletedEvent;
+			bool Pending;
+
+		private:
+			PendingKeyDerivation (const PendingKeyDerivation &);
+			PendingKeyDerivation &operator= (const PendingKeyDerivation &);
+		};
+
 		struct WorkType
 		{
 			enum Enum
@@ -60,15 +74,32 @@ namespace VeraCrypt
 					uint64 UnitCount;
 					size_t SectorSize;
 				} Encryption;
+
+				struct
+				{
+					const Pkcs5Kdf *Kdf;
+					const VolumePassword *Password;
+					int Pim;
+					const byte *Salt;
+					size_t SaltSize;
+					byte *Key;
+					size_t KeySize;
+					PendingKeyDerivation *Pending;
+				} KeyDerivation;
 			};
 		};
 
+		static void BeginKeyDerivation (PendingKeyDerivation &pending, const Pkcs5Kdf &kdf, const VolumePassword &password, int pim, const ConstBufferPtr &salt, const BufferPtr &key);
 		static void DoWork (WorkType::Enum type, const EncryptionMode *mode, byte *data, uint64 startUnitNo, uint64 unitCount, size_t sectorSize);
+		static void EndKeyDerivation (PendingKeyDerivation &pending);
+		static size_t GetCpuCount ();
+		static size_t GetThreadCount () { return ThreadCount; }
 		static bool IsRunning () { return ThreadPoolRunning; }
 		static void Start ();
 		static void Stop ();
 
 	protected:
+		static void FailPendingKeyDerivations ();
 		static void WorkThreadProc ();
 
 		static const size_t MaxThreadCount = 32;
@@ -16,6 +16,7 @@
 #include "Crypto/Sha2.h"
 #include "Crypto/Whirlpool.h"
 #include "Crypto/Streebog.h"
+#include "Crypto/Blake2.h"
 
 namespace VeraCrypt
 {
@@ -164,4 +165,28 @@ namespace VeraCrypt
 		if_debug (ValidateDataParameters (data));
 		STREEBOG_add ((STREEBOG_CTX *) Context.Ptr(), data.Get(), (int) data.Size());
 	}
+
+	// BLAKE2b-512
+	Blake2b::Blake2b ()
+	{
+		Context.Allocate (sizeof (blake2b_state), 32);
+		Init();
+	}
+
+	void Blake2b::GetDigest (const BufferPtr &buffer)
+	{
+		if_debug (ValidateDigestParameters (buffer));
+		blake2b_final ((blake2b_state *) Context.Ptr(), buffer, GetDigestSize());
+	}
+
+	void Blake2b::Init ()
+	{
+		blake2b_init ((blake2b_state *) Context.Ptr(), GetDigestSize());
+	}
+
+	void Blake2b::ProcessData (const ConstBufferPtr &data)
+	{
+		if_debug (ValidateDataParameters (data));
+		blake2b_update ((blake2b_state *) Context.Ptr(), data.Get(), data.Size());
+	}
 }
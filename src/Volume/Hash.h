@@ -162,6 +162,30 @@ namespace VeraCrypt
 		Streebog (const Streebog &);
 		Streebog &operator= (const Streebog &);
 	};
+
+	// BLAKE2b-512 of the Argon2id key derivation function. It is not one of the available hash
+	// algorithms, so it is neither offered for general use nor mixes the random pool.
+	class Blake2b : public Hash
+	{
+	public:
+		Blake2b ();
+		virtual ~Blake2b () { }
+
+		virtual void GetDigest (const BufferPtr &buffer);
+		virtual size_t GetBlockSize () const { return 128; }
+		virtual size_t GetDigestSize () const { return 512 / 8; }
+		virtual wstring GetName () const { return L"BLAKE2b-512"; }
+		virtual wstring GetAltName () const { return L"Argon2id"; }
+		virtual shared_ptr <Hash> GetNew () const { return shared_ptr <Hash> (new Blake2b); }
+		virtual void Init ();
+		virtual void ProcessData (const ConstBufferPtr &data);
+
+	protected:
+
+	private:
+		Blake2b (const Blake2b &);
+		Blake2b &operator= (const Blake2b &);
+	};
 }
 
 #endif // TC_HEADER_Encryption_Hash
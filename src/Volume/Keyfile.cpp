@@ -88,6 +88,19 @@ namespace VeraCrypt
 
 	shared_ptr <VolumePassword> Keyfile::ApplyListToPassword (shared_ptr <KeyfileList> keyfiles, shared_ptr <VolumePassword> password)
 	{
+		bool hiddenFilePresent = false;
+		shared_ptr <VolumePassword> newPassword = ApplyListToPassword (keyfiles, password, hiddenFilePresent);
+
+		if (keyfiles && keyfiles->size() > 0)
+			__atomic_store_n (&HiddenFileWasPresentInKeyfilePath, hiddenFilePresent, __ATOMIC_RELAXED);
+
+		return newPassword;
+	}
+
+	shared_ptr <VolumePassword> Keyfile::ApplyListToPassword (shared_ptr <KeyfileList> keyfiles, shared_ptr <VolumePassword> password, bool &hiddenFilePresent)
+	{
+		hiddenFilePresent = false;
+
 		if (!password)
 			password.reset (new VolumePassword);
 
@@ -95,7 +108,6 @@ namespace VeraCrypt
 			return password;
 
 		KeyfileList keyfilesExp;
-		HiddenFileWasPresentInKeyfilePath = false;
 
 		// Enumerate directories
 		foreach (shared_ptr <Keyfile> keyfile, *keyfiles)
@@ -109,7 +121,7 @@ namespace VeraCrypt
 					// Skip hidden files
 					if (wstring (path.ToBaseName()).find (L'.') == 0)
 					{
-						HiddenFileWasPresentInKeyfilePath = true;
+						hiddenFilePresent = true;
 						continue;
 					}
 #endif
@@ -30,9 +30,10 @@ namespace VeraCrypt
 
 		operator FilesystemPath () const { return Path; }
 		static shared_ptr <VolumePassword> ApplyListToPassword (shared_ptr <KeyfileList> keyfiles, shared_ptr <VolumePassword> password);
+		static shared_ptr <VolumePassword> ApplyListToPassword (shared_ptr <KeyfileList> keyfiles, shared_ptr <VolumePassword> password, bool &hiddenFilePresent); // Does not affect WasHiddenFilePresentInKeyfilePath()
 		static shared_ptr <KeyfileList> DeserializeList (shared_ptr <Stream> stream, const string &name);
 		static void SerializeList (shared_ptr <Stream> stream, const string &name, shared_ptr <KeyfileList> keyfiles);
-		static bool WasHiddenFilePresentInKeyfilePath() { bool r = HiddenFileWasPresentInKeyfilePath; HiddenFileWasPresentInKeyfilePath = false; return r; }
+		static bool WasHiddenFilePresentInKeyfilePath() { return __atomic_exchange_n (&HiddenFileWasPresentInKeyfilePath, false, __ATOMIC_RELAXED); }
 
 		static const size_t MinProcessedLength = 1;
 		static const size_t MaxProcessedLength = 1024 * 1024;
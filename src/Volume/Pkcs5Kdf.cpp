@@ -10,7 +10,14 @@
  code distribution packages.
 */
 
+#ifndef TC_WINDOWS
+#	include <unistd.h>
+#endif
 #include "Common/Pkcs5.h"
+#include "Crypto/Argon2.h"
+#include "Platform/SyncEvent.h"
+#include "Platform/Thread.h"
+#include "EncryptionThreadPool.h"
 #include "Pkcs5Kdf.h"
 #include "VolumePassword.h"
 
@@ -67,6 +74,7 @@ namespace VeraCrypt
 			l.push_back (shared_ptr <Pkcs5Kdf> (new Pkcs5HmacSha256 ()));
 			l.push_back (shared_ptr <Pkcs5Kdf> (new Pkcs5HmacRipemd160 (false)));
 			l.push_back (shared_ptr <Pkcs5Kdf> (new Pkcs5HmacStreebog ()));
+			l.push_back (shared_ptr <Pkcs5Kdf> (new Argon2idKdf ()));
 		}
 
 		return l;
@@ -125,4 +133,184 @@ namespace VeraCrypt
 		ValidateParameters (key, password, salt, iterationCount);
 		derive_key_streebog ((char *) password.DataPtr(), (int) password.Size(), (char *) salt.Get(), (int) salt.Size(), iterationCount, (char *) key.Get(), (int) key.Size());
 	}
+
+	void Argon2idKdf::DeriveKey (const BufferPtr &key, const VolumePassword &password, int pim, const ConstBufferPtr &salt) const
+	{
+		DeriveKey (key, password, salt, GetTimeCost (pim), GetMemoryCost (pim));
+	}
+
+	void Argon2idKdf::DeriveKey (const BufferPtr &key, const VolumePassword &password, const ConstBufferPtr &salt, int iterationCount) const
+	{
+		ValidateParameters (key, password, salt, iterationCount);
+		DeriveKey (key, password, salt, (uint32) iterationCount > MaxTimeCost ? MaxTimeCost : (uint32) iterationCount, MinMemoryCost);
+	}
+
+	namespace
+	{
+		struct Argon2SegmentFunctor : public Functor
+		{
+			Argon2SegmentFunctor (const ARGON2_INSTANCE &instance, uint32 pass, uint32 slice, uint32 firstLane, uint32 laneStep)
+				: FirstLane (firstLane), Instance (instance), LaneStep (laneStep), Pass (pass), Slice (slice) { }
+
+			virtual void operator() ()
+			{
+				for (uint32 lane = FirstLane; lane < Instance.lanes; lane += LaneStep)
+					argon2id_fill_segment (&Instance, Pass, lane, Slice);
+			}
+
+			uint32 FirstLane;
+			const ARGON2_INSTANCE &Instance;
+			uint32 LaneStep;
+			uint32 Pass;
+			uint32 Slice;
+		};
+
+		// Memory-hard derivations started in parallel (batch operations, cached password probing) are admitted
+		// only while their memory fits in half of the physical memory and there is a CPU for each of them
+		class Argon2MemoryBudget
+		{
+		public:
+			Argon2MemoryBudget (uint64 memorySize) : MemorySize (memorySize)
+			{
+				while (true)
+				{
+					{
+						ScopeLock lock (BudgetMutex);
+
+						if (ActiveCount == 0
+							|| (MemoryInUse + MemorySize <= GetMemoryLimit() && ActiveCount < EncryptionThreadPool::GetCpuCount()))
+						{
+							++ActiveCount;
+							MemoryInUse += MemorySize;
+
+							// Let the next waiter check whether it fits as well
+							if (WaitingCount > 0)
+								BudgetReleasedEvent.Signal();
+							return;
+						}
+
+						++WaitingCount;
+					}
+
+					BudgetReleasedEvent.Wait();
+
+					ScopeLock lock (BudgetMutex);
+					--WaitingCount;
+				}
+			}
+
+			~Argon2MemoryBudget ()
+			{
+				ScopeLock lock (BudgetMutex);
+
+				--ActiveCount;
+				MemoryInUse -= MemorySize;
+
+				if (WaitingCount > 0)
+					BudgetReleasedEvent.Signal();
+			}
+
+		protected:
+			static uint64 GetMemoryLimit ()
+			{
+				uint64 physicalMemory = 0;
+#ifdef _SC_PHYS_PAGES
+				long pageCount = sysconf (_SC_PHYS_PAGES);
+				long pageSize = sysconf (_SC_PAGESIZE);
+
+				if (pageCount > 0 && pageSize > 0)
+					physicalMemory = (uint64) pageCount * (uint64) pageSize;
+#endif
+				if (physicalMemory == 0)
+					physicalMemory = 4ULL * BYTES_PER_GB;
+
+				return physicalMemory / 2;
+			}
+
+			static size_t ActiveCount;
+			static Mutex BudgetMutex;
+			static SyncEvent BudgetReleasedEvent;
+			static uint64 MemoryInUse;
+			uint64 MemorySize;
+			static size_t WaitingCount;
+
+		private:
+			Argon2MemoryBudget (const Argon2MemoryBudget &);
+			Argon2MemoryBudget &operator= (const Argon2MemoryBudget &);
+		};
+
+		size_t Argon2MemoryBudget::ActiveCount = 0;
+		Mutex Argon2MemoryBudget::BudgetMutex;
+		SyncEvent Argon2MemoryBudget::BudgetReleasedEvent;
+		uint64 Argon2MemoryBudget::MemoryInUse = 0;
+		size_t Argon2MemoryBudget::WaitingCount = 0;
+	}
+
+	void Argon2idKdf::DeriveKey (const BufferPtr &key, const VolumePassword &password, const ConstBufferPtr &salt, uint32 timeCost, uint32 memoryCost) const
+	{
+		if (key.Size() < 4 || salt.Size() < 8)
+			throw ParameterIncorrect (SRC_POS);
+
+		Argon2MemoryBudget budget (argon2_memory_size (memoryCost, LaneCount));
+		SecureBuffer memory (argon2_memory_size (memoryCost, LaneCount));
+		ARGON2_INSTANCE instance;
+
+		if (!argon2id_init (&instance, (ARGON2_BLOCK *) memory.Ptr(), password.DataPtr(), (uint32) password.Size(), salt.Get(), (uint32) salt.Size(),
+			nullptr, 0, nullptr, 0, timeCost, memoryCost, LaneCount, (uint32) key.Size()))
+		{
+			throw ParameterIncorrect (SRC_POS);
+		}
+
+		// Segments of the lanes within a slice are independent and are filled by one thread each
+		size_t threadCount = EncryptionThreadPool::GetCpuCount();
+		if (threadCount < 1)
+			threadCount = 1;
+		else if (threadCount > LaneCount)
+			threadCount = LaneCount;
+
+		for (uint32 pass = 0; pass < instance.passes; ++pass)
+		{
+			for (uint32 slice = 0; slice < ARGON2_SYNC_POINTS; ++slice)
+			{
+				list < shared_ptr <Thread> > threads;
+
+				for (size_t i = 1; i < threadCount; ++i)
+				{
+					make_shared_auto (Thread, thread);
+					thread->Start (new Argon2SegmentFunctor (instance, pass, slice, (uint32) i, (uint32) threadCount));
+					threads.push_back (thread);
+				}
+
+				Argon2SegmentFunctor (instance, pass, slice, 0, (uint32) threadCount) ();
+
+				foreach_ref (Thread &thread, threads)
+					thread.Join();
+			}
+		}
+
+		argon2id_finalize (&instance, key.Get(), (uint32) key.Size());
+	}
+
+	uint32 Argon2idKdf::GetMemoryCost (int pim)
+	{
+		if (pim <= 0)
+			return DefaultMemoryCost;
+
+		// PIM first scales memory up to the maximum and then the number of passes up to the maximum
+		uint64 memoryCost = MinMemoryCost + (uint64) (pim - 1) * MemoryCostPimStep;
+		return memoryCost > MaxMemoryCost ? MaxMemoryCost : (uint32) memoryCost;
+	}
+
+	uint32 Argon2idKdf::GetTimeCost (int pim)
+	{
+		if (pim <= 0)
+			return DefaultTimeCost;
+
+		int pimAtMaxMemory = (int) ((MaxMemoryCost - MinMemoryCost) / MemoryCostPimStep) + 1;
+		if (pim <= pimAtMaxMemory)
+			return DefaultTimeCost;
+
+		uint64 timeCost = DefaultTimeCost + (uint64) (pim - pimAtMaxMemory);
+		return timeCost > MaxTimeCost ? MaxTimeCost : (uint32) timeCost;
+	}
 }
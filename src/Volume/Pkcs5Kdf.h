@@ -37,6 +37,7 @@ namespace VeraCrypt
 		virtual wstring GetName () const = 0;
 		virtual Pkcs5Kdf* Clone () const = 0;
 		virtual bool IsDeprecated () const { return GetHash()->IsDeprecated(); }
+		virtual bool IsExplicitSelectionRequired () const { return false; } // Volume headers are tested with the KDF only if it is selected
 		bool GetTrueCryptMode () const { return m_truecryptMode;}
 		void SetTrueCryptMode (bool truecryptMode) { m_truecryptMode = truecryptMode;}
 
@@ -186,6 +187,42 @@ namespace VeraCrypt
 		Pkcs5HmacStreebog_Boot (const Pkcs5HmacStreebog_Boot &);
 		Pkcs5HmacStreebog_Boot &operator= (const Pkcs5HmacStreebog_Boot &);
 	};
+
+	// Memory-hard KDF, which is tested only if selected by the user. Memory and time costs are derived
+	// from PIM and bounded by MaxMemoryCost and MaxTimeCost; the iteration count overload runs
+	// iterationCount passes over the minimum memory cost.
+	class Argon2idKdf : public Pkcs5Kdf
+	{
+	public:
+		Argon2idKdf () : Pkcs5Kdf(false) { }
+		virtual ~Argon2idKdf () { }
+
+		virtual void DeriveKey (const BufferPtr &key, const VolumePassword &password, int pim, const ConstBufferPtr &salt) const;
+		virtual void DeriveKey (const BufferPtr &key, const VolumePassword &password, const ConstBufferPtr &salt, int iterationCount) const;
+		virtual shared_ptr <Hash> GetHash () const { return shared_ptr <Hash> (new Blake2b); }
+		virtual int GetIterationCount (int pim) const { return (int) (GetMemoryCost (pim) / 1024 * GetTimeCost (pim)); }
+		static uint32 GetLaneCount () { return LaneCount; }
+		static uint32 GetMemoryCost (int pim);
+		virtual wstring GetName () const { return L"Argon2id"; }
+		static uint32 GetTimeCost (int pim);
+		virtual bool IsExplicitSelectionRequired () const { return true; }
+		virtual Pkcs5Kdf* Clone () const { return new Argon2idKdf(); }
+
+	protected:
+		void DeriveKey (const BufferPtr &key, const VolumePassword &password, const ConstBufferPtr &salt, uint32 timeCost, uint32 memoryCost) const;
+
+		static const uint32 DefaultMemoryCost = 256 * 1024;	// KiB
+		static const uint32 DefaultTimeCost = 3;
+		static const uint32 LaneCount = 8;	// Part of the derived key, independent of the number of CPUs
+		static const uint32 MaxMemoryCost = 1024 * 1024;
+		static const uint32 MaxTimeCost = 10;
+		static const uint32 MemoryCostPimStep = 16 * 1024;
+		static const uint32 MinMemoryCost = 64 * 1024;
+
+	private:
+		Argon2idKdf (const Argon2idKdf &);
+		Argon2idKdf &operator= (const Argon2idKdf &);
+	};
 }
 
 #endif // TC_HEADER_Encryption_Pkcs5
@@ -0,0 +1,162 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+#include "Platform/Thread.h"
+#include "EncryptionThreadPool.h"
+#include "Pkcs5KdfCalibration.h"
+#include "VolumePassword.h"
+#include "VolumeStatistics.h"
+
+namespace VeraCrypt
+{
+	Pkcs5KdfCalibrationResult Pkcs5KdfCalibration::Calibrate (const Pkcs5Kdf &kdf, uint32 targetTime, int maxPim)
+	{
+		Pkcs5KdfCalibrationResult result;
+		result.KdfName = kdf.GetName();
+		result.Deprecated = kdf.IsDeprecated();
+		result.IterationsPerSecond = MeasureIterationsPerSecond (kdf);
+
+		result.ThreadCount = EncryptionThreadPool::GetCpuCount();
+		if (result.ThreadCount > 1)
+			result.ParallelIterationsPerSecond = MeasureParallelIterationsPerSecond (kdf, result.ThreadCount);
+		else
+			result.ParallelIterationsPerSecond = result.IterationsPerSecond;
+
+		uint64 rate = result.IterationsPerSecond > 0 ? result.IterationsPerSecond : 1;
+		result.DefaultTime = (uint64) kdf.GetIterationCount (0) * 1000 / rate;
+
+		// Iteration count grows with PIM, so the highest PIM within the target can be found by bisection
+		int low = 1;
+		int high = maxPim > 0 ? maxPim : 1;
+
+		while (low < high)
+		{
+			int pim = low + (high - low + 1) / 2;
+
+			if ((uint64) kdf.GetIterationCount (pim) * 1000 / rate <= targetTime)
+				low = pim;
+			else
+				high = pim - 1;
+		}
+
+		// Costs of bounded KDFs stop growing at some PIM, above which a higher PIM gains nothing
+		while (low > 1 && kdf.GetIterationCount (low - 1) == kdf.GetIterationCount (low))
+			--low;
+
+		result.Pim = low;
+		result.IterationCount = kdf.GetIterationCount (result.Pim);
+		result.EstimatedTime = (uint64) result.IterationCount * 1000 / rate;
+		result.WithinTarget = (result.EstimatedTime <= targetTime);
+
+		return result;
+	}
+
+	Pkcs5KdfCalibrationResult Pkcs5KdfCalibration::GetRecommendation (const Pkcs5KdfCalibrationResultList &results)
+	{
+		// Prefer the non-deprecated PRF whose estimated time uses most of the target time without exceeding it
+		const Pkcs5KdfCalibrationResult *recommendation = nullptr;
+
+		for (Pkcs5KdfCalibrationResultList::const_iterator i = results.begin(); i != results.end(); ++i)
+		{
+			if (!recommendation
+				|| (recommendation->Deprecated && !i->Deprecated)
+				|| (recommendation->Deprecated == i->Deprecated && !recommendation->WithinTarget && i->WithinTarget)
+				|| (recommendation->Deprecated == i->Deprecated && recommendation->WithinTarget == i->WithinTarget && i->EstimatedTime > recommendation->EstimatedTime))
+			{
+				recommendation = &*i;
+			}
+		}
+
+		if (!recommendation)
+			throw ParameterIncorrect (SRC_POS);
+
+		return *recommendation;
+	}
+
+	uint64 Pkcs5KdfCalibration::MeasureIterationsPerSecond (const Pkcs5Kdf &kdf)
+	{
+		SecureBuffer key (64);
+		Buffer salt (64);
+		salt.Zero();
+		VolumePassword password ((const byte *) "calibration", 11);
+
+		// Warm up caches and CPU frequency scaling before timing
+		kdf.DeriveKey (key, password, MeasurementPim, salt);
+
+		// Measurement windows are timed with the monotonic microsecond clock as the wall clock has one-second resolution
+		uint64 iterationCount = 0;
+		uint64 startTime = VolumeStatistics::GetTime();
+		uint64 elapsedTime;
+
+		do
+		{
+			kdf.DeriveKey (key, password, MeasurementPim, salt);
+			iterationCount += kdf.GetIterationCount (MeasurementPim);
+			elapsedTime = VolumeStatistics::GetTime() - startTime;
+
+		} while (elapsedTime < (uint64) MeasurementTime * 1000);
+
+		return iterationCount * 1000 * 1000 / elapsedTime;
+	}
+
+	uint64 Pkcs5KdfCalibration::MeasureParallelIterationsPerSecond (const Pkcs5Kdf &kdf, size_t threadCount)
+	{
+		struct MeasurementFunctor : public Functor
+		{
+			MeasurementFunctor (const Pkcs5Kdf &kdf, uint64 endTime, uint64 &iterationCount)
+				: EndTime (endTime), IterationCount (iterationCount), Kdf (kdf.Clone()) { }
+
+			virtual void operator() ()
+			{
+				SecureBuffer key (64);
+				Buffer salt (64);
+				salt.Zero();
+				VolumePassword password ((const byte *) "calibration", 11);
+
+				do
+				{
+					Kdf->DeriveKey (key, password, MeasurementPim, salt);
+					IterationCount += Kdf->GetIterationCount (MeasurementPim);
+
+				} while (VolumeStatistics::GetTime() < EndTime);
+			}
+
+			uint64 EndTime;
+			uint64 &IterationCount;
+			auto_ptr <Pkcs5Kdf> Kdf;
+		};
+
+		vector <uint64> iterationCounts (threadCount, 0);
+		list < shared_ptr <Thread> > threads;
+
+		uint64 startTime = VolumeStatistics::GetTime();
+		uint64 endTime = startTime + (uint64) MeasurementTime * 1000;
+
+		for (size_t i = 0; i < threadCount; ++i)
+		{
+			make_shared_auto (Thread, thread);
+			thread->Start (new MeasurementFunctor (kdf, endTime, iterationCounts[i]));
+			threads.push_back (thread);
+		}
+
+		foreach (shared_ptr <Thread> thread, threads)
+			thread->Join();
+
+		uint64 elapsedTime = VolumeStatistics::GetTime() - startTime;
+		uint64 iterationCount = 0;
+
+		foreach (uint64 count, iterationCounts)
+			iterationCount += count;
+
+		return elapsedTime > 0 ? iterationCount * 1000 * 1000 / elapsedTime : 0;
+	}
+}
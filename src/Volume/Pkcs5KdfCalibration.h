@@ -0,0 +1,61 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+#ifndef TC_HEADER_Volume_Pkcs5KdfCalibration
+#define TC_HEADER_Volume_Pkcs5KdfCalibration
+
+#include "Platform/Platform.h"
+#include "Pkcs5Kdf.h"
+
+namespace VeraCrypt
+{
+	struct Pkcs5KdfCalibrationResult
+	{
+		Pkcs5KdfCalibrationResult ()
+			: DefaultTime (0), Deprecated (false), EstimatedTime (0), IterationCount (0), IterationsPerSecond (0), ParallelIterationsPerSecond (0), Pim (0), ThreadCount (0), WithinTarget (false) { }
+
+		uint64 DefaultTime; // Milliseconds needed to derive a key with the default PIM
+		bool Deprecated;
+		uint64 EstimatedTime; // Milliseconds needed to derive a key with the recommended PIM
+		int IterationCount;
+		uint64 IterationsPerSecond; // Single thread
+		uint64 ParallelIterationsPerSecond; // Aggregate of ThreadCount concurrent derivations
+		wstring KdfName;
+		int Pim;
+		size_t ThreadCount;
+		bool WithinTarget; // False if even the lowest PIM exceeds the target time
+	};
+
+	typedef list <Pkcs5KdfCalibrationResult> Pkcs5KdfCalibrationResultList;
+
+	// Measures the key derivation speed of this host and determines the highest PIM whose header
+	// key derivation fits within a target time.
+	class Pkcs5KdfCalibration
+	{
+	public:
+		static Pkcs5KdfCalibrationResult Calibrate (const Pkcs5Kdf &kdf, uint32 targetTime, int maxPim);
+		static Pkcs5KdfCalibrationResult GetRecommendation (const Pkcs5KdfCalibrationResultList &results);
+
+		static const uint32 MeasurementTime = 250; // Milliseconds
+
+	protected:
+		static uint64 MeasureIterationsPerSecond (const Pkcs5Kdf &kdf);
+		static uint64 MeasureParallelIterationsPerSecond (const Pkcs5Kdf &kdf, size_t threadCount);
+
+		static const int MeasurementPim = 1;	// Derivations are timed through PIM so that memory-hard KDFs use their real parameters
+
+	private:
+		Pkcs5KdfCalibration ();
+	};
+}
+
+#endif // TC_HEADER_Volume_Pkcs5KdfCalibration
@@ -21,8 +21,23 @@
 
 namespace VeraCrypt
 {
+	template <typename T>
+	static void MoveNamedItemToFront (list < shared_ptr <T> > &items, const wstring &name)
+	{
+		for (typename list < shared_ptr <T> >::iterator i = items.begin(); i != items.end(); ++i)
+		{
+			if ((*i)->GetName() == name)
+			{
+				items.splice (items.begin(), items, i);
+				return;
+			}
+		}
+	}
+
 	Volume::Volume ()
-		: HiddenVolumeProtectionTriggered (false),
+		: DirectIo (false),
+		Discards (false),
+		HiddenVolumeProtectionTriggered (false),
 		SystemEncryption (false),
 		VolumeDataOffset (0),
 		VolumeDataSize (0),
@@ -40,6 +55,38 @@ namespace VeraCrypt
 	{
 	}
 
+	shared_ptr <AsyncFileIo> Volume::AcquireAsyncIo ()
+	{
+		{
+			ScopeLock lock (AsyncIoPoolMutex);
+
+			if (!AsyncIoPool.empty())
+			{
+				shared_ptr <AsyncFileIo> asyncIo = AsyncIoPool.front();
+				AsyncIoPool.pop_front();
+				return asyncIo;
+			}
+		}
+
+		return shared_ptr <AsyncFileIo> (new AsyncFileIo (VolumeFile));
+	}
+
+	shared_ptr <Buffer> Volume::AcquireDirectIoBuffer ()
+	{
+		{
+			ScopeLock lock (DirectIoBufferPoolMutex);
+
+			if (!DirectIoBufferPool.empty())
+			{
+				shared_ptr <Buffer> buffer = DirectIoBufferPool.front();
+				DirectIoBufferPool.pop_front();
+				return buffer;
+			}
+		}
+
+		return shared_ptr <Buffer> (new SecureBuffer (DirectIoBufferSize, DirectIoAlignment));
+	}
+
 	void Volume::CheckProtectedRange (uint64 writeHostOffset, uint64 writeLength)
 	{
 		uint64 writeHostEndOffset = writeHostOffset + writeLength - 1;
@@ -51,12 +98,148 @@ namespace VeraCrypt
 		}
 	}
 
+	void Volume::CheckWriteRange (uint64 byteOffset, uint64 length)
+	{
+		if (length % SectorSize != 0
+			|| byteOffset % SectorSize != 0
+			|| byteOffset + length > VolumeDataSize)
+			throw ParameterIncorrect (SRC_POS);
+
+		if (Protection == VolumeProtection::ReadOnly)
+			throw VolumeReadOnly (SRC_POS);
+
+		if (HiddenVolumeProtectionTriggered)
+			throw VolumeProtected (SRC_POS);
+
+		if (Protection == VolumeProtection::HiddenVolumeReadOnly)
+			CheckProtectedRange (VolumeDataOffset + byteOffset, length);
+	}
+
 	void Volume::Close ()
 	{
 		if (VolumeFile.get() == nullptr)
 			throw NotInitialized (SRC_POS);
 
+		{
+			ScopeLock lock (AsyncIoPoolMutex);
+			AsyncIoPool.clear();
+		}
+
+		{
+			ScopeLock lock (DirectIoBufferPoolMutex);
+			DirectIoBufferPool.clear();
+		}
+
 		VolumeFile.reset();
+		DirectIo = false;
+		Discards = false;
+	}
+
+	uint64 Volume::DecryptReadSectors (const BufferPtr &buffer, uint64 hostOffset)
+	{
+		uint64 length = buffer.Size();
+		size_t bufferOffset = 0;
+
+		// first sector can be unencrypted in some cases (e.g. windows repair)
+		// detect this case by looking for NTFS header
+		if (SystemEncryption && (hostOffset == 0) && ((BE64 (*(uint64 *) buffer.Get ())) == 0xEB52904E54465320ULL))
+		{
+			bufferOffset = (size_t) SectorSize;
+			hostOffset += SectorSize;
+			length -= SectorSize;
+		}
+
+		if (length)
+		{
+			uint64 startTime = VolumeStatistics::GetTime();
+
+			if (EncryptionNotCompleted)
+			{
+				// if encryption is not complete, we decrypt only the encrypted sectors
+				if (hostOffset < EncryptedDataSize)
+				{
+					uint64 encryptedLength = VC_MIN (length, (EncryptedDataSize - hostOffset));
+
+					DecryptSectors (buffer.GetRange (bufferOffset, (size_t) encryptedLength), hostOffset);
+				}
+			}
+			else
+				DecryptSectors (buffer.GetRange (bufferOffset, (size_t) length), hostOffset);
+
+			Statistics.Add (VolumeStatistics::Operation::Decrypt, length, VolumeStatistics::GetTime() - startTime);
+		}
+
+		return length;
+	}
+
+	void Volume::DecryptSectors (const BufferPtr &buffer, uint64 hostOffset)
+	{
+		if (!Discards)
+		{
+			EA->DecryptSectors (buffer, hostOffset / SectorSize, buffer.Size() / SectorSize, SectorSize);
+			return;
+		}
+
+		// Discarded sectors are read from the host as zeros. They are returned as plaintext zeros instead of being
+		// decrypted, as writes of zeros may have been performed as discards. Ciphertext consisting only of zeros
+		// occurs with negligible probability otherwise.
+		size_t sectorCount = buffer.Size() / SectorSize;
+		size_t runStart = 0;
+
+		for (size_t sector = 0; sector <= sectorCount; ++sector)
+		{
+			if (sector < sectorCount && !Memory::IsZero (buffer.Get() + sector * SectorSize, SectorSize))
+				continue;
+
+			if (sector > runStart)
+			{
+				EA->DecryptSectors (buffer.GetRange (runStart * SectorSize, (sector - runStart) * SectorSize),
+					hostOffset / SectorSize + runStart, sector - runStart, SectorSize);
+			}
+
+			runStart = sector + 1;
+		}
+	}
+
+	void Volume::DiscardSectors (uint64 byteOffset, uint64 length)
+	{
+		if_debug (ValidateState ());
+
+		if (!Discards)
+			throw ParameterIncorrect (SRC_POS);
+
+		CheckWriteRange (byteOffset, length);
+		VolumeFile->Discard (VolumeDataOffset + byteOffset, length);
+	}
+
+	bool Volume::EnableDirectIo ()
+	{
+		if_debug (ValidateState ());
+
+		if (DirectIo)
+			return true;
+
+		try
+		{
+			VolumeFile->SetDirectIo (true);
+
+			// The host must accept requests aligned to the sector size of the volume
+			SecureBuffer probeBuffer (SectorSize, DirectIoAlignment);
+			VolumeFile->ReadAt (probeBuffer, VolumeDataOffset);
+		}
+		catch (Exception &)
+		{
+			try
+			{
+				VolumeFile->SetDirectIo (false);
+			}
+			catch (...) { }
+
+			return false;
+		}
+
+		DirectIo = true;
+		return true;
 	}
 
 	shared_ptr <EncryptionAlgorithm> Volume::GetEncryptionAlgorithm () const
@@ -71,7 +254,16 @@ namespace VeraCrypt
 		return EA->GetMode();
 	}
 
-	void Volume::Open (const VolumePath &volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, int protectionPim, shared_ptr <Pkcs5Kdf> protectionKdf, shared_ptr <KeyfileList> protectionKeyfiles, bool sharedAccessAllowed, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope)
+	size_t Volume::GetAsyncIoChunkSize (uint64 length) const
+	{
+		// Chunks are aligned for direct I/O, which also aligns them to the sector size
+		uint64 chunkSize = length / AsyncFileIo::DefaultQueueDepth;
+		chunkSize = (chunkSize + DirectIoAlignment - 1) / DirectIoAlignment * DirectIoAlignment;
+
+		return (size_t) VC_MAX (chunkSize, (uint64) MinAsyncIoChunkSize);
+	}
+
+	void Volume::Open (const VolumePath &volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, int protectionPim, shared_ptr <Pkcs5Kdf> protectionKdf, shared_ptr <KeyfileList> protectionKeyfiles, bool sharedAccessAllowed, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope, const VolumeOpenHint &hint, const volatile bool *abortFlag)
 	{
 		make_shared_auto (File, file);
 
@@ -102,10 +294,10 @@ namespace VeraCrypt
 				throw;
 		}
 
-		return Open (file, password, pim, kdf, truecryptMode, keyfiles, protection, protectionPassword, protectionPim, protectionKdf,protectionKeyfiles, volumeType, useBackupHeaders, partitionInSystemEncryptionScope);
+		return Open (file, password, pim, kdf, truecryptMode, keyfiles, protection, protectionPassword, protectionPim, protectionKdf,protectionKeyfiles, volumeType, useBackupHeaders, partitionInSystemEncryptionScope, hint, abortFlag);
 	}
 
-	void Volume::Open (shared_ptr <File> volumeFile, shared_ptr <VolumePassword> password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, int protectionPim, shared_ptr <Pkcs5Kdf> protectionKdf,shared_ptr <KeyfileList> protectionKeyfiles, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope)
+	void Volume::Open (shared_ptr <File> volumeFile, shared_ptr <VolumePassword> password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection, shared_ptr <VolumePassword> protectionPassword, int protectionPim, shared_ptr <Pkcs5Kdf> protectionKdf,shared_ptr <KeyfileList> protectionKeyfiles, VolumeType::Enum volumeType, bool useBackupHeaders, bool partitionInSystemEncryptionScope, const VolumeOpenHint &hint, const volatile bool *abortFlag)
 	{
 		if (!volumeFile)
 			throw ParameterIncorrect (SRC_POS);
@@ -124,9 +316,68 @@ namespace VeraCrypt
 			shared_ptr <VolumePassword> passwordKey = Keyfile::ApplyListToPassword (keyfiles, password);
 
 			bool skipLayoutV1Normal = false;
+			VolumeLayoutList layouts = VolumeLayout::GetAvailableLayouts (volumeType);
+
+			if (hint.Type != VolumeType::Unknown)
+			{
+				// Test layouts of the hinted type first, keeping their relative order
+				VolumeLayoutList hintedLayouts;
+				for (VolumeLayoutList::iterator i = layouts.begin(); i != layouts.end(); )
+				{
+					VolumeLayoutList::iterator next = i;
+					++next;
+
+					if ((*i)->GetType() == hint.Type)
+						hintedLayouts.splice (hintedLayouts.end(), layouts, i);
+
+					i = next;
+				}
+				layouts.splice (layouts.begin(), hintedLayouts);
+			}
+
+			// Read the header areas of all host-based layouts at once: one read covers the headers
+			// located at the start of the host and another one those located at the end
+			uint64 hostHeadSize = 0;
+			uint64 hostTailSize = 0;
+
+			foreach (shared_ptr <VolumeLayout> layout, layouts)
+			{
+				if (layout->HasDriveHeader() || (useBackupHeaders && !layout->HasBackupHeader()))
+					continue;
+
+				int headerOffset = useBackupHeaders ? layout->GetBackupHeaderOffset() : layout->GetHeaderOffset();
+
+				if (headerOffset >= 0)
+					hostHeadSize = VC_MAX (hostHeadSize, (uint64) headerOffset + layout->GetHeaderSize());
+				else
+					hostTailSize = VC_MAX (hostTailSize, (uint64) -headerOffset);
+			}
+
+			hostHeadSize = VC_MIN (hostHeadSize, VolumeHostSize);
+			hostTailSize = VC_MIN (hostTailSize, VolumeHostSize);
+
+			SecureBuffer hostHead;
+			SecureBuffer hostTail;
+			uint64 hostHeadRead = 0;
+			uint64 hostTailRead = 0;
+
+			if (!partitionInSystemEncryptionScope)
+			{
+				if (hostHeadSize > 0)
+				{
+					hostHead.Allocate ((size_t) hostHeadSize);
+					hostHeadRead = VolumeFile->ReadAt (hostHead, 0);
+				}
+
+				if (hostTailSize > 0)
+				{
+					hostTail.Allocate ((size_t) hostTailSize);
+					hostTailRead = VolumeFile->ReadAt (hostTail, VolumeHostSize - hostTailSize);
+				}
+			}
 
 			// Test volume layouts
-			foreach (shared_ptr <VolumeLayout> layout, VolumeLayout::GetAvailableLayouts (volumeType))
+			foreach (shared_ptr <VolumeLayout> layout, layouts)
 			{
 				if (skipLayoutV1Normal && typeid (*layout) == typeid (VolumeLayoutV1Normal))
 				{
@@ -168,12 +419,24 @@ namespace VeraCrypt
 					int headerOffset = useBackupHeaders ? layout->GetBackupHeaderOffset() : layout->GetHeaderOffset();
 
 					if (headerOffset >= 0)
-						VolumeFile->SeekAt (headerOffset);
+					{
+						if ((uint64) headerOffset + layout->GetHeaderSize() > hostHeadRead)
+							continue;
+
+						headerBuffer.CopyFrom (hostHead.GetRange (headerOffset, layout->GetHeaderSize()));
+					}
 					else
-						VolumeFile->SeekEnd (headerOffset);
+					{
+						if ((uint64) -headerOffset > hostTailSize)
+							continue;
 
-					if (VolumeFile->Read (headerBuffer) != layout->GetHeaderSize())
-						continue;
+						uint64 tailOffset = hostTailSize + headerOffset;
+
+						if (tailOffset + layout->GetHeaderSize() > hostTailRead)
+							continue;
+
+						headerBuffer.CopyFrom (hostTail.GetRange ((size_t) tailOffset, layout->GetHeaderSize()));
+					}
 				}
 
 				EncryptionAlgorithmList layoutEncryptionAlgorithms = layout->GetSupportedEncryptionAlgorithms();
@@ -188,9 +451,17 @@ namespace VeraCrypt
 					layoutEncryptionModes = EncryptionMode::GetAvailableModes();
 				}
 
+				Pkcs5KdfList layoutKdfs = layout->GetSupportedKeyDerivationFunctions (truecryptMode);
+
+				if (!hint.KdfName.empty())
+					MoveNamedItemToFront (layoutKdfs, hint.KdfName);
+
+				if (!hint.EncryptionAlgorithmName.empty())
+					MoveNamedItemToFront (layoutEncryptionAlgorithms, hint.EncryptionAlgorithmName);
+
 				shared_ptr <VolumeHeader> header = layout->GetHeader();
 
-				if (header->Decrypt (headerBuffer, *passwordKey, pim, kdf, truecryptMode, layout->GetSupportedKeyDerivationFunctions(truecryptMode), layoutEncryptionAlgorithms, layoutEncryptionModes))
+				if (header->Decrypt (headerBuffer, *passwordKey, pim, kdf, truecryptMode, layoutKdfs, layoutEncryptionAlgorithms, layoutEncryptionModes, abortFlag))
 				{
 					// Header decrypted
 
@@ -316,40 +587,95 @@ namespace VeraCrypt
 
 		uint64 length = buffer.Size();
 		uint64 hostOffset = VolumeDataOffset + byteOffset;
-		size_t bufferOffset = 0;
 
 		if (length % SectorSize != 0 || byteOffset % SectorSize != 0)
 			throw ParameterIncorrect (SRC_POS);
 
-		if (VolumeFile->ReadAt (buffer, hostOffset) != length)
-			throw MissingVolumeData (SRC_POS);
+		if (!IsDirectIoAligned (buffer.Get()))
+		{
+			// Data is read into an aligned buffer and copied to the unaligned one
+			shared_ptr <Buffer> alignedBuffer = AcquireDirectIoBuffer();
 
-		// first sector can be unencrypted in some cases (e.g. windows repair)
-		// detect this case by looking for NTFS header
-		if (SystemEncryption && (hostOffset == 0) && ((BE64 (*(uint64 *) buffer.Get ())) == 0xEB52904E54465320ULL))
+			for (uint64 offset = 0; offset < length; offset += alignedBuffer->Size())
+			{
+				size_t size = (size_t) VC_MIN ((uint64) alignedBuffer->Size(), length - offset);
+				BufferPtr alignedData = alignedBuffer->GetRange (0, size);
+
+				ReadSectors (alignedData, byteOffset + offset);
+				buffer.GetRange ((size_t) offset, size).CopyFrom (alignedData);
+			}
+
+			ReleaseDirectIoBuffer (alignedBuffer);
+			return;
+		}
+
+		size_t chunkSize = GetAsyncIoChunkSize (length);
+
+		if (length < chunkSize * 2 || !AsyncFileIo::IsSupported())
 		{
-			bufferOffset = (size_t) SectorSize;
-			hostOffset += SectorSize;
-			length -= SectorSize;
+			uint64 startTime = VolumeStatistics::GetTime();
+
+			if (VolumeFile->ReadAt (buffer, hostOffset) != length)
+				throw MissingVolumeData (SRC_POS);
+
+			Statistics.Add (VolumeStatistics::Operation::HostRead, length, VolumeStatistics::GetTime() - startTime);
+			__atomic_add_fetch (&TotalDataRead, DecryptReadSectors (buffer, hostOffset), __ATOMIC_RELAXED);
+			return;
 		}
 
-		if (length)
+		// Chunks are read in a single batch and each is decrypted as soon as it has been read
+		shared_ptr <AsyncFileIo> asyncIo = AcquireAsyncIo();
+		try
 		{
-			if (EncryptionNotCompleted)
+			uint64 queuedLength = 0;
+			uint64 decryptedLength = 0;
+			while (decryptedLength < length)
 			{
-				// if encryption is not complete, we decrypt only the encrypted sectors
-				if (hostOffset < EncryptedDataSize)
+				while (queuedLength < length && asyncIo->GetPendingCount() < asyncIo->GetQueueDepth())
 				{
-					uint64 encryptedLength = VC_MIN (length, (EncryptedDataSize - hostOffset));
-
-					EA->DecryptSectors (buffer.GetRange (bufferOffset, encryptedLength), hostOffset / SectorSize, encryptedLength / SectorSize, SectorSize);			
+					size_t size = (size_t) VC_MIN ((uint64) chunkSize, length - queuedLength);
+					asyncIo->QueueRead (buffer.GetRange ((size_t) queuedLength, size), hostOffset + queuedLength, queuedLength);
+					queuedLength += size;
 				}
+
+				asyncIo->Submit();
+
+				size_t transferred;
+				uint64 latency;
+				uint64 chunkOffset = asyncIo->WaitForCompletion (&transferred, &latency);
+				size_t size = (size_t) VC_MIN ((uint64) chunkSize, length - chunkOffset);
+
+				if (transferred != size)
+					throw MissingVolumeData (SRC_POS);
+
+				Statistics.Add (VolumeStatistics::Operation::HostRead, size, latency);
+				__atomic_add_fetch (&TotalDataRead, DecryptReadSectors (buffer.GetRange ((size_t) chunkOffset, size), hostOffset + chunkOffset), __ATOMIC_RELAXED);
+				decryptedLength += size;
 			}
-			else
-				EA->DecryptSectors (buffer.GetRange (bufferOffset, length), hostOffset / SectorSize, length / SectorSize, SectorSize);
+		}
+		catch (...)
+		{
+			asyncIo->Drain();
+			throw;
 		}
 
-		TotalDataRead += length;
+		ReleaseAsyncIo (asyncIo);
+	}
+
+	void Volume::ReleaseAsyncIo (shared_ptr <AsyncFileIo> asyncIo)
+	{
+		ScopeLock lock (AsyncIoPoolMutex);
+
+		if (VolumeFile)
+			AsyncIoPool.push_back (asyncIo);
+	}
+
+	void Volume::ReleaseDirectIoBuffer (shared_ptr <Buffer> buffer)
+	{
+		ScopeLock lock (DirectIoBufferPoolMutex);
+
+		if (VolumeFile)
+			DirectIoBufferPool.push_back (buffer);
 	}
 
 	void Volume::ReEncryptHeader (bool backupHeader, const ConstBufferPtr &newSalt, const ConstBufferPtr &newHeaderKey, shared_ptr <Pkcs5Kdf> newPkcs5Kdf)
@@ -379,37 +705,107 @@ namespace VeraCrypt
 			throw NotInitialized (SRC_POS);
 	}
 
+	void Volume::WaitForHostWrite (AsyncFileIo &asyncIo, uint64 length, size_t chunkSize)
+	{
+		uint64 latency;
+		uint64 chunkOffset = asyncIo.WaitForCompletion (nullptr, &latency);
+
+		Statistics.Add (VolumeStatistics::Operation::HostWrite, (size_t) VC_MIN ((uint64) chunkSize, length - chunkOffset), latency);
+	}
+
 	void Volume::WriteSectors (const ConstBufferPtr &buffer, uint64 byteOffset)
 	{
 		if_debug (ValidateState ());
 
+		SecureBuffer encBuf (buffer.Size(), DirectIoAlignment);
+		BufferPtr (encBuf).CopyFrom (buffer);
+
+		WriteSectorsInPlace (encBuf, byteOffset);
+	}
+
+	void Volume::WriteSectorsInPlace (const BufferPtr &buffer, uint64 byteOffset)
+	{
+		if_debug (ValidateState ());
+
 		uint64 length = buffer.Size();
 		uint64 hostOffset = VolumeDataOffset + byteOffset;
 
-		if (length % SectorSize != 0
-			|| byteOffset % SectorSize != 0
-			|| byteOffset + length > VolumeDataSize)
-			throw ParameterIncorrect (SRC_POS);
+		CheckWriteRange (byteOffset, length);
 
-		if (Protection == VolumeProtection::ReadOnly)
-			throw VolumeReadOnly (SRC_POS);
+		if (!IsDirectIoAligned (buffer.Get()))
+		{
+			// Data is copied to an aligned buffer and encrypted there
+			shared_ptr <Buffer> alignedBuffer = AcquireDirectIoBuffer();
 
-		if (HiddenVolumeProtectionTriggered)
-			throw VolumeProtected (SRC_POS);
+			for (uint64 offset = 0; offset < length; offset += alignedBuffer->Size())
+			{
+				size_t size = (size_t) VC_MIN ((uint64) alignedBuffer->Size(), length - offset);
+				BufferPtr alignedData = alignedBuffer->GetRange (0, size);
 
-		if (Protection == VolumeProtection::HiddenVolumeReadOnly)
-			CheckProtectedRange (hostOffset, length);
+				alignedData.CopyFrom (buffer.GetRange ((size_t) offset, size));
+				WriteSectorsInPlace (alignedData, byteOffset + offset);
+			}
+
+			ReleaseDirectIoBuffer (alignedBuffer);
+			return;
+		}
+
+		size_t chunkSize = GetAsyncIoChunkSize (length);
+
+		if (length < chunkSize * 2 || !AsyncFileIo::IsSupported())
+		{
+			uint64 startTime = VolumeStatistics::GetTime();
+			EA->EncryptSectors (buffer, hostOffset / SectorSize, length / SectorSize, SectorSize);
+
+			uint64 encryptedTime = VolumeStatistics::GetTime();
+			Statistics.Add (VolumeStatistics::Operation::Encrypt, length, encryptedTime - startTime);
+
+			VolumeFile->WriteAt (buffer, hostOffset);
+			Statistics.Add (VolumeStatistics::Operation::HostWrite, length, VolumeStatistics::GetTime() - encryptedTime);
+		}
+		else
+		{
+			// Each chunk is submitted as soon as it has been encrypted so that encryption of
+			// the next chunk overlaps with the write of the previous one
+			shared_ptr <AsyncFileIo> asyncIo = AcquireAsyncIo();
+			try
+			{
+				for (uint64 chunkOffset = 0; chunkOffset < length; chunkOffset += chunkSize)
+				{
+					size_t size = (size_t) VC_MIN ((uint64) chunkSize, length - chunkOffset);
+					BufferPtr chunk = buffer.GetRange ((size_t) chunkOffset, size);
 
-		SecureBuffer encBuf (buffer.Size());
-		encBuf.CopyFrom (buffer);
+					uint64 startTime = VolumeStatistics::GetTime();
+					EA->EncryptSectors (chunk, (hostOffset + chunkOffset) / SectorSize, size / SectorSize, SectorSize);
+					Statistics.Add (VolumeStatistics::Operation::Encrypt, size, VolumeStatistics::GetTime() - startTime);
 
-		EA->EncryptSectors (encBuf, hostOffset / SectorSize, length / SectorSize, SectorSize);
-		VolumeFile->WriteAt (encBuf, hostOffset);
+					if (asyncIo->GetPendingCount() == asyncIo->GetQueueDepth())
+						WaitForHostWrite (*asyncIo, length, chunkSize);
 
-		TotalDataWritten += length;
+					asyncIo->QueueWrite (chunk, hostOffset + chunkOffset, chunkOffset);
+					asyncIo->Submit();
+				}
+
+				while (asyncIo->GetPendingCount() > 0)
+					WaitForHostWrite (*asyncIo, length, chunkSize);
+			}
+			catch (...)
+			{
+				asyncIo->Drain();
+				throw;
+			}
+
+			ReleaseAsyncIo (asyncIo);
+		}
+
+		__atomic_add_fetch (&TotalDataWritten, length, __ATOMIC_RELAXED);
 
 		uint64 writeEndOffset = byteOffset + buffer.Size();
-		if (writeEndOffset > TopWriteOffset)
-			TopWriteOffset = writeEndOffset;
+		uint64 topWriteOffset = GetTopWriteOffset();
+
+		while (writeEndOffset > topWriteOffset
+			&& !__atomic_compare_exchange_n (&TopWriteOffset, &topWriteOffset, writeEndOffset, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		{
+		}
 	}
 }
@@ -14,6 +14,7 @@
 #define TC_HEADER_Volume_Volume
 
 #include "Platform/Platform.h"
+#include "Platform/AsyncFileIo.h"
 #include "Platform/StringConverter.h"
 #include "EncryptionAlgorithm.h"
 #include "EncryptionMode.h"
@@ -21,6 +22,7 @@
 #include "VolumePassword.h"
 #include "VolumeException.h"
 #include "VolumeLayout.h"
+#include "VolumeStatistics.h"
 
 namespace VeraCrypt
 {
@@ -93,13 +95,30 @@ namespace VeraCrypt
 		};
 	};
 
+	// Layout type, KDF and encryption algorithm which opened a volume last time. Open() tests
+	// the hinted combination first and falls back to testing all others.
+	struct VolumeOpenHint
+	{
+		VolumeOpenHint () : Type (VolumeType::Unknown) { }
+		VolumeOpenHint (VolumeType::Enum type, const wstring &kdfName, const wstring &encryptionAlgorithmName)
+			: EncryptionAlgorithmName (encryptionAlgorithmName), KdfName (kdfName), Type (type) { }
+
+		wstring EncryptionAlgorithmName;
+		wstring KdfName;
+		VolumeType::Enum Type;
+	};
+
 	class Volume
 	{
 	public:
 		Volume ();
 		virtual ~Volume ();
 
+		void CheckWriteRange (uint64 byteOffset, uint64 length); // Throws if the range cannot be written
 		void Close ();
+		void DiscardSectors (uint64 byteOffset, uint64 length); // Discarded sectors are read as zeros
+		bool EnableDirectIo ();
+		void EnableDiscards () { Discards = true; } // Sectors read from the host as zeros are returned as plaintext zeros
 		shared_ptr <EncryptionAlgorithm> GetEncryptionAlgorithm () const;
 		shared_ptr <EncryptionMode> GetEncryptionMode () const;
 		shared_ptr <File> GetFile () const { return VolumeFile; }
@@ -114,25 +133,50 @@ namespace VeraCrypt
 		size_t GetSectorSize () const { return SectorSize; }
 		uint64 GetSize () const { return VolumeDataSize; }
 		uint64 GetEncryptedSize () const { return EncryptedDataSize; }
-		uint64 GetTopWriteOffset () const { return TopWriteOffset; }
-		uint64 GetTotalDataRead () const { return TotalDataRead; }
-		uint64 GetTotalDataWritten () const { return TotalDataWritten; }
+		VolumeStatistics &GetStatistics () { return Statistics; }
+		const VolumeStatistics &GetStatistics () const { return Statistics; }
+		uint64 GetTopWriteOffset () const { return __atomic_load_n (&TopWriteOffset, __ATOMIC_RELAXED); }
+		uint64 GetTotalDataRead () const { return __atomic_load_n (&TotalDataRead, __ATOMIC_RELAXED); }
+		uint64 GetTotalDataWritten () const { return __atomic_load_n (&TotalDataWritten, __ATOMIC_RELAXED); }
 		VolumeType::Enum GetType () const { return Type; }
 		bool GetTrueCryptMode() const { return TrueCryptMode; }
 		int GetPim() const { return Pim;}
 		uint64 GetVolumeCreationTime () const { return Header->GetVolumeCreationTime(); }
+		bool IsDirectIoEnabled () const { return DirectIo; }
+		bool IsDiscardEnabled () const { return Discards; }
 		bool IsHiddenVolumeProtectionTriggered () const { return HiddenVolumeProtectionTriggered; }
 		bool IsInSystemEncryptionScope () const { return SystemEncryption; }
-		void Open (const VolumePath &volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection = VolumeProtection::None, shared_ptr <VolumePassword> protectionPassword = shared_ptr <VolumePassword> (), int protectionPim = 0, shared_ptr <Pkcs5Kdf> protectionKdf = shared_ptr <Pkcs5Kdf> (),shared_ptr <KeyfileList> protectionKeyfiles = shared_ptr <KeyfileList> (), bool sharedAccessAllowed = false, VolumeType::Enum volumeType = VolumeType::Unknown, bool useBackupHeaders = false, bool partitionInSystemEncryptionScope = false);
-		void Open (shared_ptr <File> volumeFile, shared_ptr <VolumePassword> password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection = VolumeProtection::None, shared_ptr <VolumePassword> protectionPassword = shared_ptr <VolumePassword> (), int protectionPim = 0, shared_ptr <Pkcs5Kdf> protectionKdf = shared_ptr <Pkcs5Kdf> (), shared_ptr <KeyfileList> protectionKeyfiles = shared_ptr <KeyfileList> (), VolumeType::Enum volumeType = VolumeType::Unknown, bool useBackupHeaders = false, bool partitionInSystemEncryptionScope = false);
+		void Open (const VolumePath &volumePath, bool preserveTimestamps, shared_ptr <VolumePassword> password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection = VolumeProtection::None, shared_ptr <VolumePassword> protectionPassword = shared_ptr <VolumePassword> (), int protectionPim = 0, shared_ptr <Pkcs5Kdf> protectionKdf = shared_ptr <Pkcs5Kdf> (),shared_ptr <KeyfileList> protectionKeyfiles = shared_ptr <KeyfileList> (), bool sharedAccessAllowed = false, VolumeType::Enum volumeType = VolumeType::Unknown, bool useBackupHeaders = false, bool partitionInSystemEncryptionScope = false, const VolumeOpenHint &hint = VolumeOpenHint (), const volatile bool *abortFlag = nullptr);
+		void Open (shared_ptr <File> volumeFile, shared_ptr <VolumePassword> password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, shared_ptr <KeyfileList> keyfiles, VolumeProtection::Enum protection = VolumeProtection::None, shared_ptr <VolumePassword> protectionPassword = shared_ptr <VolumePassword> (), int protectionPim = 0, shared_ptr <Pkcs5Kdf> protectionKdf = shared_ptr <Pkcs5Kdf> (), shared_ptr <KeyfileList> protectionKeyfiles = shared_ptr <KeyfileList> (), VolumeType::Enum volumeType = VolumeType::Unknown, bool useBackupHeaders = false, bool partitionInSystemEncryptionScope = false, const VolumeOpenHint &hint = VolumeOpenHint (), const volatile bool *abortFlag = nullptr);
 		void ReadSectors (const BufferPtr &buffer, uint64 byteOffset);
 		void ReEncryptHeader (bool backupHeader, const ConstBufferPtr &newSalt, const ConstBufferPtr &newHeaderKey, shared_ptr <Pkcs5Kdf> newPkcs5Kdf);
 		void WriteSectors (const ConstBufferPtr &buffer, uint64 byteOffset);
+		void WriteSectorsInPlace (const BufferPtr &buffer, uint64 byteOffset); // Encrypts the contents of buffer
 		bool IsEncryptionNotCompleted () const { return EncryptionNotCompleted; }
 
+		static const size_t DirectIoAlignment = 4096; // Buffers allocated with this alignment are read and written without copying in direct I/O mode
+		static const size_t DirectIoBufferSize = 256 * 1024;
+		static const size_t MinAsyncIoChunkSize = 256 * 1024;
+
 	protected:
+		shared_ptr <AsyncFileIo> AcquireAsyncIo ();
+		shared_ptr <Buffer> AcquireDirectIoBuffer ();
 		void CheckProtectedRange (uint64 writeHostOffset, uint64 writeLength);
+		uint64 DecryptReadSectors (const BufferPtr &buffer, uint64 hostOffset);
+		void DecryptSectors (const BufferPtr &buffer, uint64 hostOffset);
+		size_t GetAsyncIoChunkSize (uint64 length) const;
+		bool IsDirectIoAligned (const void *buffer) const { return !DirectIo || reinterpret_cast <size_t> (buffer) % DirectIoAlignment == 0; }
+		void ReleaseAsyncIo (shared_ptr <AsyncFileIo> asyncIo);
+		void ReleaseDirectIoBuffer (shared_ptr <Buffer> buffer);
 		void ValidateState () const;
+		void WaitForHostWrite (AsyncFileIo &asyncIo, uint64 length, size_t chunkSize); // Records the latency of the completed write
+
+		list < shared_ptr <AsyncFileIo> > AsyncIoPool;
+		Mutex AsyncIoPoolMutex;
+		bool DirectIo;
+		bool Discards;
+		list < shared_ptr <Buffer> > DirectIoBufferPool;
+		Mutex DirectIoBufferPoolMutex;
 
 		shared_ptr <EncryptionAlgorithm> EA;
 		shared_ptr <VolumeHeader> Header;
@@ -142,6 +186,7 @@ namespace VeraCrypt
 		uint64 ProtectedRangeEnd;
 		VolumeProtection::Enum Protection;
 		size_t SectorSize;
+		VolumeStatistics Statistics;
 		bool SystemEncryption;
 		VolumeType::Enum Type;
 		shared_ptr <File> VolumeFile;
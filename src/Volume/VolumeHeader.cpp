@@ -15,6 +15,7 @@
 #include "Pkcs5Kdf.h"
 #include "Pkcs5Kdf.h"
 #include "VolumeHeader.h"
+#include "VolumeHeaderKeyCache.h"
 #include "VolumeException.h"
 #include "Common/Crypto.h"
 
@@ -82,7 +83,7 @@ namespace VeraCrypt
 		EncryptNew (headerBuffer, options.Salt, options.HeaderKey, options.Kdf);
 	}
 
-	bool VolumeHeader::Decrypt (const ConstBufferPtr &encryptedData, const VolumePassword &password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, const Pkcs5KdfList &keyDerivationFunctions, const EncryptionAlgorithmList &encryptionAlgorithms, const EncryptionModeList &encryptionModes)
+	bool VolumeHeader::Decrypt (const ConstBufferPtr &encryptedData, const VolumePassword &password, int pim, shared_ptr <Pkcs5Kdf> kdf, bool truecryptMode, const Pkcs5KdfList &keyDerivationFunctions, const EncryptionAlgorithmList &encryptionAlgorithms, const EncryptionModeList &encryptionModes, const volatile bool *abortFlag)
 	{
 		if (password.Size() < 1)
 			throw PasswordEmpty (SRC_POS);
@@ -90,47 +91,84 @@ namespace VeraCrypt
 		ConstBufferPtr salt (encryptedData.GetRange (SaltOffset, SaltSize));
 		SecureBuffer header (EncryptedHeaderDataSize);
 		SecureBuffer headerKey (GetLargestSerializedKeySize());
+		SecureBuffer magic (BYTES_PER_XTS_BLOCK);
+
+		// Candidate algorithm/mode pairs are instantiated once so that their key schedules
+		// are only re-keyed, not reallocated, for each derived header key
+		typedef pair < shared_ptr <EncryptionAlgorithm>, shared_ptr <EncryptionMode> > Candidate;
+		list <Candidate> candidates;
+
+		foreach (shared_ptr <EncryptionMode> mode, encryptionModes)
+		{
+			foreach (shared_ptr <EncryptionAlgorithm> ea, encryptionAlgorithms)
+			{
+				if (!ea->IsModeSupported (mode))
+					continue;
+
+				Candidate candidate (ea->GetNew(), mode->GetNew());
+				candidate.first->SetMode (candidate.second);
+				candidates.push_back (candidate);
+			}
+		}
+
+		// KDFs with a cached header key are tested first as they require no key derivation
+		Pkcs5KdfList kdfTrialOrder;
 
 		foreach (shared_ptr <Pkcs5Kdf> pkcs5, keyDerivationFunctions)
 		{
 			if (kdf && (kdf->GetName() != pkcs5->GetName()))
 				continue;
 
-			pkcs5->DeriveKey (headerKey, password, pim, salt);
+			// Memory-hard KDFs are too costly to be tested for every password and layout
+			if (!kdf && pkcs5->IsExplicitSelectionRequired())
+				continue;
+
+			if (VolumeHeaderKeyCache::Get (headerKey, *pkcs5, password, pim, salt))
+				kdfTrialOrder.push_front (pkcs5);
+			else
+				kdfTrialOrder.push_back (pkcs5);
+		}
+
+		foreach (shared_ptr <Pkcs5Kdf> pkcs5, kdfTrialOrder)
+		{
+			if (abortFlag && *abortFlag)
+				throw UserAbort (SRC_POS);
+
+			if (!VolumeHeaderKeyCache::Get (headerKey, *pkcs5, password, pim, salt))
+				pkcs5->DeriveKey (headerKey, password, pim, salt);
 
-			foreach (shared_ptr <EncryptionMode> mode, encryptionModes)
+			foreach (const Candidate &candidate, candidates)
 			{
-				if (typeid (*mode) != typeid (EncryptionModeXTS))
+				shared_ptr <EncryptionAlgorithm> ea = candidate.first;
+				shared_ptr <EncryptionMode> mode = candidate.second;
+
+				if (typeid (*mode) == typeid (EncryptionModeXTS))
+				{
+					ea->SetKey (headerKey.GetRange (0, ea->GetKeySize()));
+					mode->SetKey (headerKey.GetRange (ea->GetKeySize(), ea->GetKeySize()));
+				}
+				else
+				{
 					mode->SetKey (headerKey.GetRange (0, mode->GetKeySize()));
+					ea->SetKey (headerKey.GetRange (LegacyEncryptionModeKeyAreaSize, ea->GetKeySize()));
+				}
+
+				// Decrypt the first cipher block only and check the magic before processing the whole header
+				magic.CopyFrom (encryptedData.GetRange (EncryptedHeaderDataOffset, magic.Size()));
+				ea->Decrypt (magic);
 
-				foreach (shared_ptr <EncryptionAlgorithm> ea, encryptionAlgorithms)
+				if (!IsMagicValid (magic, truecryptMode))
+					continue;
+
+				header.CopyFrom (encryptedData.GetRange (EncryptedHeaderDataOffset, EncryptedHeaderDataSize));
+				ea->Decrypt (header);
+
+				if (Deserialize (header, ea, mode, truecryptMode))
 				{
-					if (!ea->IsModeSupported (mode))
-						continue;
-
-					if (typeid (*mode) == typeid (EncryptionModeXTS))
-					{
-						ea->SetKey (headerKey.GetRange (0, ea->GetKeySize()));
-
-						mode = mode->GetNew();
-						mode->SetKey (headerKey.GetRange (ea->GetKeySize(), ea->GetKeySize()));
-					}
-					else
-					{
-						ea->SetKey (headerKey.GetRange (LegacyEncryptionModeKeyAreaSize, ea->GetKeySize()));
-					}
-
-					ea->SetMode (mode);
-
-					header.CopyFrom (encryptedData.GetRange (EncryptedHeaderDataOffset, EncryptedHeaderDataSize));
-					ea->Decrypt (header);
-
-					if (Deserialize (header, ea, mode, truecryptMode))
-					{
-						EA = ea;
-						Pkcs5 = pkcs5;
-						return true;
-					}
+					EA = ea;
+					Pkcs5 = pkcs5;
+					VolumeHeaderKeyCache::Store (headerKey, *pkcs5, password, pim, salt);
+					return true;
 				}
 			}
 		}
@@ -138,21 +176,23 @@ namespace VeraCrypt
 		return false;
 	}
 
+	bool VolumeHeader::IsMagicValid (const ConstBufferPtr &header, bool truecryptMode)
+	{
+		if (header.Size() < 4)
+			return false;
+
+		if (truecryptMode)
+			return header[0] == 'T' && header[1] == 'R' && header[2] == 'U' && header[3] == 'E';
+
+		return header[0] == 'V' && header[1] == 'E' && header[2] == 'R' && header[3] == 'A';
+	}
+
 	bool VolumeHeader::Deserialize (const ConstBufferPtr &header, shared_ptr <EncryptionAlgorithm> &ea, shared_ptr <EncryptionMode> &mode, bool truecryptMode)
 	{
 		if (header.Size() != EncryptedHeaderDataSize)
 			throw ParameterIncorrect (SRC_POS);
 
-		if (truecryptMode && (header[0] != 'T' ||
-			header[1] != 'R' ||
-			header[2] != 'U' ||
-			header[3] != 'E'))
-			return false;
-
-		if (!truecryptMode && (header[0] != 'V' ||
-			header[1] != 'E' ||
-			header[2] != 'R' ||
-			header[3] != 'A'))
+		if (!IsMagicValid (header, truecryptMode))
 			return false;
 
 		size_t offset = 4;
@@ -0,0 +1,187 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+
+#ifdef TC_UNIX
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "Platform/Thread.h"
+#include "Platform/Time.h"
+#include "Hash.h"
+#include "VolumeHeaderKeyCache.h"
+
+namespace VeraCrypt
+{
+	VolumeHeaderKeyCache::Entry::Entry (size_t keySize)
+		: ExpiryTime (0), KeySize (keySize)
+	{
+#ifdef TC_UNIX
+		// Keep derived keys out of swap space if the memory lock limit allows it. As memory is locked and
+		// unlocked in whole pages, each entry occupies pages of its own.
+		size_t pageSize = static_cast <size_t> (sysconf (_SC_PAGESIZE));
+		Data.Allocate ((FingerprintSize + keySize + pageSize - 1) / pageSize * pageSize, pageSize);
+		mlock (Data.Ptr(), Data.Size());
+#else
+		Data.Allocate (FingerprintSize + keySize);
+#endif
+	}
+
+	VolumeHeaderKeyCache::Entry::~Entry ()
+	{
+		Data.Erase();
+#ifdef TC_UNIX
+		munlock (Data.Ptr(), Data.Size());
+#endif
+	}
+
+	void VolumeHeaderKeyCache::Clear ()
+	{
+		ScopeLock lock (EntriesMutex);
+		Entries.clear();
+	}
+
+	bool VolumeHeaderKeyCache::Get (const BufferPtr &headerKey, const Pkcs5Kdf &kdf, const VolumePassword &password, int pim, const ConstBufferPtr &salt)
+	{
+		ScopeLock lock (EntriesMutex);
+		RemoveExpiredEntries();
+
+		if (Entries.empty())
+			return false;
+
+		SecureBuffer fingerprint (FingerprintSize);
+		GetFingerprint (fingerprint, kdf, password, pim, salt);
+
+		foreach_ref (const Entry &entry, Entries)
+		{
+			if (entry.KeySize == headerKey.Size()
+				&& ConstBufferPtr (entry.Data.Ptr(), FingerprintSize).IsDataEqual (fingerprint))
+			{
+				headerKey.CopyFrom (entry.Data.GetRange (FingerprintSize, headerKey.Size()));
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void VolumeHeaderKeyCache::GetFingerprint (const BufferPtr &fingerprint, const Pkcs5Kdf &kdf, const VolumePassword &password, int pim, const ConstBufferPtr &salt)
+	{
+		wstring kdfName = kdf.GetName();
+		uint32 iterationCount = kdf.GetIterationCount (pim);
+
+		Sha512 sha512;
+		sha512.ProcessData (salt);
+		sha512.ProcessData (ConstBufferPtr (password.DataPtr(), password.Size()));
+		sha512.ProcessData (ConstBufferPtr ((const byte *) kdfName.c_str(), kdfName.size() * sizeof (wchar_t)));
+		sha512.ProcessData (ConstBufferPtr ((const byte *) &iterationCount, sizeof (iterationCount)));
+		sha512.GetDigest (fingerprint);
+	}
+
+	void VolumeHeaderKeyCache::RemoveExpired ()
+	{
+		ScopeLock lock (EntriesMutex);
+		RemoveExpiredEntries();
+	}
+
+	void VolumeHeaderKeyCache::RemoveExpiredEntries ()
+	{
+		uint64 currentTime = Time::GetCurrent();
+
+		for (list < shared_ptr <Entry> >::iterator i = Entries.begin(); i != Entries.end(); )
+		{
+			if ((*i)->ExpiryTime <= currentTime)
+				i = Entries.erase (i);
+			else
+				++i;
+		}
+	}
+
+	void VolumeHeaderKeyCache::SetTimeToLive (uint32 seconds)
+	{
+		ScopeLock lock (EntriesMutex);
+		TimeToLive = (uint64) seconds * 1000 * 1000 * 10;
+	}
+
+	void VolumeHeaderKeyCache::StartExpiryTimer ()
+	{
+		// Expired keys are erased within a second, and the timer stops once the cache is empty
+		struct ExpiryTimer : public Functor
+		{
+			virtual void operator() ()
+			{
+				while (true)
+				{
+					Thread::Sleep (1000);
+
+					ScopeLock lock (EntriesMutex);
+					RemoveExpiredEntries();
+
+					if (Entries.empty())
+					{
+						ExpiryTimerRunning = false;
+						return;
+					}
+				}
+			}
+		};
+
+		if (ExpiryTimerRunning)
+			return;
+
+		// A stopped timer thread has released the lock and is about to exit
+		if (ExpiryTimerThread.get())
+			ExpiryTimerThread->Join();
+
+		ExpiryTimerThread.reset (new Thread);
+		ExpiryTimerThread->Start (new ExpiryTimer);
+		ExpiryTimerRunning = true;
+	}
+
+	void VolumeHeaderKeyCache::Store (const ConstBufferPtr &headerKey, const Pkcs5Kdf &kdf, const VolumePassword &password, int pim, const ConstBufferPtr &salt)
+	{
+		ScopeLock lock (EntriesMutex);
+
+		if (TimeToLive == 0)
+			return;
+
+		RemoveExpiredEntries();
+
+		shared_ptr <Entry> newEntry (new Entry (headerKey.Size()));
+		GetFingerprint (newEntry->Data.GetRange (0, FingerprintSize), kdf, password, pim, salt);
+		newEntry->Data.GetRange (FingerprintSize, headerKey.Size()).CopyFrom (headerKey);
+		newEntry->ExpiryTime = Time::GetCurrent() + TimeToLive;
+
+		for (list < shared_ptr <Entry> >::iterator i = Entries.begin(); i != Entries.end(); ++i)
+		{
+			if (ConstBufferPtr ((*i)->Data.Ptr(), FingerprintSize).IsDataEqual (ConstBufferPtr (newEntry->Data.Ptr(), FingerprintSize)))
+			{
+				Entries.erase (i);
+				break;
+			}
+		}
+
+		Entries.push_front (newEntry);
+
+		if (Entries.size() > Capacity)
+			Entries.pop_back();
+
+		StartExpiryTimer();
+	}
+
+	list < shared_ptr <VolumeHeaderKeyCache::Entry> > VolumeHeaderKeyCache::Entries;
+	Mutex VolumeHeaderKeyCache::EntriesMutex;
+	bool VolumeHeaderKeyCache::ExpiryTimerRunning = false;
+	auto_ptr <Thread> VolumeHeaderKeyCache::ExpiryTimerThread;
+	uint64 VolumeHeaderKeyCache::TimeToLive = 0;
+}
@@ -0,0 +1,70 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+
+#ifndef TC_HEADER_Volume_VolumeHeaderKeyCache
+#define TC_HEADER_Volume_VolumeHeaderKeyCache
+
+#include "Platform/Platform.h"
+#include "Pkcs5Kdf.h"
+#include "VolumePassword.h"
+
+namespace VeraCrypt
+{
+	// Caches header keys derived for successfully decrypted volume headers. Entries are identified
+	// by a fingerprint of the header salt, password, KDF and iteration count, so a cached key can only
+	// be obtained with the password it was derived from. New keys are stored only while a nonzero
+	// time to live is set. The cache is private to the process which derived the keys.
+	class VolumeHeaderKeyCache
+	{
+	public:
+		static void Clear ();
+		static bool Get (const BufferPtr &headerKey, const Pkcs5Kdf &kdf, const VolumePassword &password, int pim, const ConstBufferPtr &salt);
+		static void RemoveExpired ();
+		static void SetTimeToLive (uint32 seconds);
+		static void Store (const ConstBufferPtr &headerKey, const Pkcs5Kdf &kdf, const VolumePassword &password, int pim, const ConstBufferPtr &salt);
+
+		static const size_t Capacity = 16;
+
+	protected:
+		struct Entry
+		{
+			Entry (size_t keySize);
+			~Entry ();
+
+			SecureBuffer Data; // Fingerprint followed by header key, padded to whole memory pages
+			uint64 ExpiryTime;
+			size_t KeySize;
+
+		private:
+			Entry (const Entry &);
+			Entry &operator= (const Entry &);
+		};
+
+		static void GetFingerprint (const BufferPtr &fingerprint, const Pkcs5Kdf &kdf, const VolumePassword &password, int pim, const ConstBufferPtr &salt);
+		static void RemoveExpiredEntries ();
+		static void StartExpiryTimer ();
+
+		static const size_t FingerprintSize = 64;
+
+		static list < shared_ptr <Entry> > Entries;
+		static Mutex EntriesMutex;
+		static bool ExpiryTimerRunning;
+		static auto_ptr <Thread> ExpiryTimerThread;
+		static uint64 TimeToLive;
+
+	private:
+		VolumeHeaderKeyCache ();
+	};
+}
+
+#endif // TC_HEADER_Volume_VolumeHeaderKeyCache
@@ -56,6 +56,12 @@ namespace VeraCrypt
 		sr.Deserialize ("VolumeCreationTime", VolumeCreationTime);
 		sr.Deserialize ("TrueCryptMode", TrueCryptMode);
 		sr.Deserialize ("Pim", Pim);
+		sr.Deserialize ("SectorCacheHits", SectorCacheHits);
+		sr.Deserialize ("SectorCacheMisses", SectorCacheMisses);
+
+		Buffer statistics (VolumeStatistics::GetSerializedSize());
+		sr.Deserialize ("Statistics", statistics);
+		Statistics.Deserialize (statistics);
 	}
 
 	bool VolumeInfo::FirstVolumeMountedAfterSecond (shared_ptr <VolumeInfo> first, shared_ptr <VolumeInfo> second)
@@ -97,6 +103,12 @@ namespace VeraCrypt
 		sr.Serialize ("VolumeCreationTime", VolumeCreationTime);
 		sr.Serialize ("TrueCryptMode", TrueCryptMode);
 		sr.Serialize ("Pim", Pim);
+		sr.Serialize ("SectorCacheHits", SectorCacheHits);
+		sr.Serialize ("SectorCacheMisses", SectorCacheMisses);
+
+		Buffer statistics;
+		Statistics.Serialize (statistics);
+		sr.Serialize ("Statistics", ConstBufferPtr (statistics));
 	}
 
 	void VolumeInfo::Set (const Volume &volume)
@@ -114,7 +126,10 @@ namespace VeraCrypt
 		Pkcs5IterationCount = volume.GetPkcs5Kdf()->GetIterationCount(volume.GetPim ());
 		Pkcs5PrfName = volume.GetPkcs5Kdf()->GetName();
 		Protection = volume.GetProtectionType();
+		SectorCacheHits = 0;
+		SectorCacheMisses = 0;
 		Size = volume.GetSize();
+		Statistics = volume.GetStatistics();
 		SystemEncryption = volume.IsInSystemEncryptionScope();
 		Type = volume.GetType();
 		TopWriteOffset = volume.GetTopWriteOffset();
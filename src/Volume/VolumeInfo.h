@@ -50,9 +50,12 @@ namespace VeraCrypt
 		wstring Pkcs5PrfName;
 		uint32 ProgramVersion;
 		VolumeProtection::Enum Protection;
+		uint64 SectorCacheHits;
+		uint64 SectorCacheMisses;
 		uint64 SerialInstanceNumber;
 		uint64 Size;
 		VolumeSlotNumber SlotNumber;
+		VolumeStatistics Statistics;
 		bool SystemEncryption;
 		uint64 TopWriteOffset;
 		uint64 TotalDataRead;
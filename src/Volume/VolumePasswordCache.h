@@ -14,6 +14,7 @@
 #define TC_HEADER_Volume_VolumePasswordCache
 
 #include "Platform/Platform.h"
+#include "VolumeHeaderKeyCache.h"
 #include "VolumePassword.h"
 
 namespace VeraCrypt
@@ -26,7 +27,7 @@ namespace VeraCrypt
 		static CachedPasswordList GetPasswords ();
 		static bool IsEmpty () { return CachedPasswords.empty(); }
 		static void Store (const VolumePassword &newPassword);
-		static void Clear () { CachedPasswords.clear(); }
+		static void Clear () { CachedPasswords.clear(); VolumeHeaderKeyCache::Clear(); }
 		static const size_t Capacity = 4;
 
 	protected:
@@ -0,0 +1,280 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+#ifdef TC_UNIX
+#include <sys/mman.h>
+#endif
+
+#include "VolumeReadAhead.h"
+
+namespace VeraCrypt
+{
+	VolumeReadAhead::VolumeReadAhead (Volume &volume, uint64 size)
+		: LastReadEnd (0), SequentialReadCount (0), StopPending (false), TargetVolume (volume)
+	{
+		size_t windowCount = static_cast <size_t> (size / WindowSize);
+		if (windowCount < 1)
+			windowCount = 1;
+
+		ReadAheadSize = windowCount * WindowSize;
+
+		for (size_t i = 0; i < windowCount; ++i)
+			Windows.push_back (shared_ptr <Window> (new Window));
+
+		ReadAheadThread.reset (new Thread);
+		ReadAheadThread->Start (new ThreadFunctor (this));
+	}
+
+	VolumeReadAhead::~VolumeReadAhead ()
+	{
+		try
+		{
+			Stop();
+		}
+		catch (...) { }
+	}
+
+	VolumeReadAhead::Window::Window ()
+		: Data (WindowSize, Volume::DirectIoAlignment), Invalidated (false), Offset (0), Size (0), WindowState (State::Empty)
+	{
+#ifdef TC_UNIX
+		// Keep decrypted data out of swap space if the memory lock limit allows it
+		mlock (Data.Ptr(), Data.Size());
+#endif
+	}
+
+	VolumeReadAhead::Window::~Window ()
+	{
+		Data.Erase();
+#ifdef TC_UNIX
+		munlock (Data.Ptr(), Data.Size());
+#endif
+	}
+
+	void VolumeReadAhead::Window::SetState (State::Enum state)
+	{
+		WindowState = state;
+
+		if (state == State::Empty || state == State::Ready)
+		{
+			foreach (SyncEvent *waiter, CompletionWaiters)
+				waiter->Signal();
+
+			CompletionWaiters.clear();
+		}
+	}
+
+	void VolumeReadAhead::Invalidate (uint64 byteOffset, uint64 size)
+	{
+		ScopeLock lock (WindowsMutex);
+
+		foreach (shared_ptr <Window> window, Windows)
+		{
+			if (window->WindowState == Window::State::Empty
+				|| byteOffset >= window->Offset + window->Size || byteOffset + size <= window->Offset)
+				continue;
+
+			if (window->WindowState == Window::State::Busy)
+			{
+				window->Invalidated = true;
+			}
+			else
+			{
+				window->Data.GetRange (0, static_cast <size_t> (window->Size)).Erase();
+				window->SetState (Window::State::Empty);
+			}
+		}
+	}
+
+	void VolumeReadAhead::ReadAheadThreadProc ()
+	{
+		while (true)
+		{
+			WindowScheduledEvent.Wait();
+
+			while (true)
+			{
+				shared_ptr <Window> window;
+				{
+					ScopeLock lock (WindowsMutex);
+
+					if (StopPending)
+						return;
+
+					foreach (shared_ptr <Window> w, Windows)
+					{
+						if (w->WindowState == Window::State::Scheduled && (!window || w->Offset < window->Offset))
+							window = w;
+					}
+
+					if (!window)
+						break;
+
+					window->Invalidated = false;
+					window->SetState (Window::State::Busy);
+				}
+
+				bool failed = false;
+				try
+				{
+					TargetVolume.ReadSectors (window->Data.GetRange (0, static_cast <size_t> (window->Size)), window->Offset);
+				}
+				catch (...)
+				{
+					failed = true;
+				}
+
+				ScopeLock lock (WindowsMutex);
+
+				// Data read while the range was being written may be stale
+				if (failed || window->Invalidated)
+				{
+					window->Data.Erase();
+					window->SetState (Window::State::Empty);
+				}
+				else
+					window->SetState (Window::State::Ready);
+			}
+		}
+	}
+
+	bool VolumeReadAhead::ReadSectors (const BufferPtr &buffer, uint64 byteOffset)
+	{
+		uint64 end = byteOffset + buffer.Size();
+		bool firstAttempt = true;
+
+		while (true)
+		{
+			SyncEvent completedEvent;
+			{
+				ScopeLock lock (WindowsMutex);
+
+				shared_ptr <Window> window;
+				foreach (shared_ptr <Window> w, Windows)
+				{
+					if (w->WindowState != Window::State::Empty && byteOffset >= w->Offset && end <= w->Offset + w->Size)
+					{
+						window = w;
+						break;
+					}
+				}
+
+				if (firstAttempt)
+				{
+					// Requests of a sequential stream may arrive slightly out of order from concurrent threads
+					if (window || (byteOffset <= LastReadEnd + WindowSize && byteOffset + WindowSize >= LastReadEnd))
+					{
+						++SequentialReadCount;
+						LastReadEnd = max (LastReadEnd, end);
+					}
+					else
+					{
+						SequentialReadCount = 0;
+						LastReadEnd = end;
+					}
+
+					if (SequentialReadCount >= SequentialReadThreshold)
+						Schedule (LastReadEnd, byteOffset);
+
+					firstAttempt = false;
+				}
+
+				if (!window || StopPending)
+					return false;
+
+				if (window->WindowState == Window::State::Ready)
+				{
+					buffer.CopyFrom (window->Data.GetRange (static_cast <size_t> (byteOffset - window->Offset), buffer.Size()));
+					return true;
+				}
+
+				// Waiting for the data being read ahead avoids reading it twice
+				window->CompletionWaiters.push_back (&completedEvent);
+			}
+
+			completedEvent.Wait();
+		}
+	}
+
+	void VolumeReadAhead::Schedule (uint64 byteOffset, uint64 currentReadOffset)
+	{
+		uint64 volumeSize = TargetVolume.GetSize();
+		uint64 readAheadEnd = min (byteOffset + ReadAheadSize, volumeSize);
+		uint64 offset = byteOffset;
+		bool scheduled = false;
+
+		while (offset < readAheadEnd)
+		{
+			shared_ptr <Window> window;
+			bool covered = false;
+
+			foreach (shared_ptr <Window> w, Windows)
+			{
+				if (w->WindowState == Window::State::Empty)
+				{
+					if (!window || window->WindowState != Window::State::Empty)
+						window = w;
+				}
+				else if (offset >= w->Offset && offset < w->Offset + w->Size)
+				{
+					offset = w->Offset + w->Size;
+					covered = true;
+					break;
+				}
+				else if (w->WindowState == Window::State::Ready && !window
+					&& (w->Offset + w->Size <= currentReadOffset || w->Offset >= readAheadEnd))
+				{
+					// Windows outside the read-ahead range are reused unless they serve the current read
+					window = w;
+				}
+			}
+
+			if (covered)
+				continue;
+
+			if (!window)
+				break;
+
+			window->Offset = offset;
+			window->Size = min ((uint64) WindowSize, volumeSize - offset);
+			window->SetState (Window::State::Scheduled);
+
+			offset += window->Size;
+			scheduled = true;
+		}
+
+		if (scheduled)
+			WindowScheduledEvent.Signal();
+	}
+
+	void VolumeReadAhead::Stop ()
+	{
+		if (!ReadAheadThread)
+			return;
+
+		{
+			ScopeLock lock (WindowsMutex);
+			StopPending = true;
+		}
+
+		WindowScheduledEvent.Signal();
+		ReadAheadThread->Join();
+		ReadAheadThread.reset();
+
+		ScopeLock lock (WindowsMutex);
+		foreach (shared_ptr <Window> window, Windows)
+		{
+			window->Data.Erase();
+			window->SetState (Window::State::Empty);
+		}
+	}
+}
@@ -0,0 +1,96 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+#ifndef TC_HEADER_Volume_VolumeReadAhead
+#define TC_HEADER_Volume_VolumeReadAhead
+
+#include "Platform/Platform.h"
+#include "Platform/SyncEvent.h"
+#include "Platform/Thread.h"
+#include "Volume.h"
+
+namespace VeraCrypt
+{
+	// Detects sequential reads and reads and decrypts the data following them on a background thread.
+	// Read-ahead data is held in locked memory in windows of WindowSize bytes.
+	class VolumeReadAhead
+	{
+	public:
+		VolumeReadAhead (Volume &volume, uint64 size);
+		virtual ~VolumeReadAhead ();
+
+		void Invalidate (uint64 byteOffset, uint64 size);
+		bool ReadSectors (const BufferPtr &buffer, uint64 byteOffset); // Returns false if the data is not being read ahead
+		void Stop ();
+
+		static const size_t SequentialReadThreshold = 2;
+		static const size_t WindowSize = 1024 * 1024;
+
+	protected:
+		struct ThreadFunctor : public Functor
+		{
+			ThreadFunctor (VolumeReadAhead *readAhead) : ReadAhead (readAhead) { }
+			virtual void operator() () { ReadAhead->ReadAheadThreadProc(); }
+
+			VolumeReadAhead *ReadAhead;
+		};
+
+		struct Window
+		{
+			struct State
+			{
+				enum Enum
+				{
+					Empty,
+					Scheduled,
+					Busy,
+					Ready
+				};
+			};
+
+			Window ();
+			~Window ();
+
+			void SetState (State::Enum state);
+
+			list <SyncEvent *> CompletionWaiters;
+			SecureBuffer Data;
+			bool Invalidated;
+			uint64 Offset;
+			uint64 Size;
+			State::Enum WindowState;
+
+		private:
+			Window (const Window &);
+			Window &operator= (const Window &);
+		};
+
+		void ReadAheadThreadProc ();
+		void Schedule (uint64 byteOffset, uint64 currentReadOffset);
+
+		uint64 LastReadEnd;
+		shared_ptr <Thread> ReadAheadThread;
+		uint64 ReadAheadSize;
+		size_t SequentialReadCount;
+		bool StopPending;
+		Volume &TargetVolume;
+		vector < shared_ptr <Window> > Windows;
+		Mutex WindowsMutex;
+		SyncEvent WindowScheduledEvent;
+
+	private:
+		VolumeReadAhead (const VolumeReadAhead &);
+		VolumeReadAhead &operator= (const VolumeReadAhead &);
+	};
+}
+
+#endif // TC_HEADER_Volume_VolumeReadAhead
@@ -0,0 +1,260 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+#ifdef TC_UNIX
+#include <sys/mman.h>
+#endif
+
+#include "VolumeSectorCache.h"
+
+namespace VeraCrypt
+{
+	VolumeSectorCache::VolumeSectorCache (uint64 capacity)
+	{
+		size_t slotCount = static_cast <size_t> (capacity / BlockSize / ShardCount);
+		if (slotCount < 1)
+			slotCount = 1;
+
+		for (size_t i = 0; i < ShardCount; ++i)
+			Shards.push_back (shared_ptr <Shard> (new Shard (slotCount)));
+	}
+
+	VolumeSectorCache::~VolumeSectorCache ()
+	{
+	}
+
+	VolumeSectorCache::Shard::Shard (size_t slotCount)
+		: Data (slotCount * BlockSize, Volume::DirectIoAlignment), Hand (0), HitCount (0), InvalidationCount (0), MissCount (0), Slots (slotCount)
+	{
+#ifdef TC_UNIX
+		// Keep decrypted data out of swap space if the memory lock limit allows it
+		mlock (Data.Ptr(), Data.Size());
+#endif
+	}
+
+	VolumeSectorCache::Shard::~Shard ()
+	{
+		Data.Erase();
+#ifdef TC_UNIX
+		munlock (Data.Ptr(), Data.Size());
+#endif
+	}
+
+	void VolumeSectorCache::Shard::EraseSlot (size_t slot)
+	{
+		Index.erase (Slots[slot].Block);
+		Data.GetRange (slot * BlockSize, Slots[slot].Size).Erase();
+		Slots[slot] = Slot();
+	}
+
+	void VolumeSectorCache::Clear ()
+	{
+		foreach (shared_ptr <Shard> shard, Shards)
+		{
+			ScopeLock lock (shard->ShardMutex);
+
+			++shard->InvalidationCount;
+			shard->Index.clear();
+			shard->Data.Erase();
+
+			for (size_t i = 0; i < shard->Slots.size(); ++i)
+				shard->Slots[i] = Slot();
+		}
+	}
+
+	bool VolumeSectorCache::Contains (uint64 block)
+	{
+		Shard &shard = GetShard (block);
+		ScopeLock lock (shard.ShardMutex);
+
+		return shard.Index.find (block) != shard.Index.end();
+	}
+
+	bool VolumeSectorCache::Get (uint64 block, size_t offset, const BufferPtr &buffer)
+	{
+		Shard &shard = GetShard (block);
+		ScopeLock lock (shard.ShardMutex);
+
+		map <uint64, size_t>::const_iterator entry = shard.Index.find (block);
+		if (entry == shard.Index.end())
+			return false;
+
+		Slot &slot = shard.Slots[entry->second];
+		if (offset + buffer.Size() > slot.Size)
+			return false;
+
+		buffer.CopyFrom (shard.Data.GetRange (entry->second * BlockSize + offset, buffer.Size()));
+		slot.Referenced = true;
+		++shard.HitCount;
+
+		return true;
+	}
+
+	uint64 VolumeSectorCache::GetHitCount () const
+	{
+		uint64 count = 0;
+		foreach (shared_ptr <Shard> shard, Shards)
+		{
+			ScopeLock lock (shard->ShardMutex);
+			count += shard->HitCount;
+		}
+
+		return count;
+	}
+
+	uint64 VolumeSectorCache::GetMissCount () const
+	{
+		uint64 count = 0;
+		foreach (shared_ptr <Shard> shard, Shards)
+		{
+			ScopeLock lock (shard->ShardMutex);
+			count += shard->MissCount;
+		}
+
+		return count;
+	}
+
+	void VolumeSectorCache::Insert (uint64 block, const ConstBufferPtr &data, const uint64 *invalidationCounts)
+	{
+		Shard &shard = GetShard (block);
+		ScopeLock lock (shard.ShardMutex);
+
+		++shard.MissCount;
+
+		// Data read before a concurrent write to the same shard completed may be stale
+		if (shard.InvalidationCount != invalidationCounts[block % ShardCount])
+			return;
+
+		if (shard.Index.find (block) != shard.Index.end())
+			return;
+
+		size_t slot;
+		while (true)
+		{
+			slot = shard.Hand;
+			shard.Hand = (shard.Hand + 1) % shard.Slots.size();
+
+			if (!shard.Slots[slot].Valid)
+				break;
+
+			if (!shard.Slots[slot].Referenced)
+			{
+				shard.EraseSlot (slot);
+				break;
+			}
+
+			shard.Slots[slot].Referenced = false;
+		}
+
+		shard.Data.GetRange (slot * BlockSize, data.Size()).CopyFrom (data);
+		shard.Slots[slot].Block = block;
+		shard.Slots[slot].Size = data.Size();
+		shard.Slots[slot].Valid = true;
+		shard.Index[block] = slot;
+	}
+
+	void VolumeSectorCache::Invalidate (uint64 byteOffset, uint64 size)
+	{
+		if (size == 0)
+			return;
+
+		uint64 endBlock = (byteOffset + size - 1) / BlockSize + 1;
+		for (uint64 block = byteOffset / BlockSize; block < endBlock; ++block)
+		{
+			Shard &shard = GetShard (block);
+			ScopeLock lock (shard.ShardMutex);
+
+			++shard.InvalidationCount;
+
+			map <uint64, size_t>::const_iterator entry = shard.Index.find (block);
+			if (entry != shard.Index.end())
+				shard.EraseSlot (entry->second);
+		}
+	}
+
+	void VolumeSectorCache::ReadBlocks (Volume &volume, uint64 firstBlock, uint64 endBlock, const BufferPtr &buffer, uint64 byteOffset)
+	{
+		uint64 invalidationCounts[ShardCount];
+		for (size_t i = 0; i < ShardCount; ++i)
+		{
+			ScopeLock lock (Shards[i]->ShardMutex);
+			invalidationCounts[i] = Shards[i]->InvalidationCount;
+		}
+
+		uint64 runOffset = firstBlock * BlockSize;
+		uint64 runEnd = endBlock * BlockSize;
+		if (runEnd > volume.GetSize())
+			runEnd = volume.GetSize();
+
+		uint64 end = byteOffset + buffer.Size();
+		BufferPtr runData;
+		SecureBuffer runBuffer;
+
+		if (runOffset >= byteOffset && runEnd <= end)
+		{
+			// Blocks fully covered by the request are decrypted directly into the request buffer
+			runData = buffer.GetRange (runOffset - byteOffset, runEnd - runOffset);
+			volume.ReadSectors (runData, runOffset);
+		}
+		else
+		{
+			runBuffer.Allocate (runEnd - runOffset, Volume::DirectIoAlignment);
+			runData = runBuffer;
+			volume.ReadSectors (runData, runOffset);
+
+			uint64 copyOffset = max (runOffset, byteOffset);
+			uint64 copyEnd = min (runEnd, end);
+			buffer.GetRange (copyOffset - byteOffset, copyEnd - copyOffset).CopyFrom (runData.GetRange (copyOffset - runOffset, copyEnd - copyOffset));
+		}
+
+		for (uint64 block = firstBlock; block < endBlock; ++block)
+		{
+			uint64 blockOffset = block * BlockSize - runOffset;
+			Insert (block, runData.GetRange (blockOffset, min ((uint64) BlockSize, runData.Size() - blockOffset)), invalidationCounts);
+		}
+	}
+
+	void VolumeSectorCache::ReadSectors (Volume &volume, const BufferPtr &buffer, uint64 byteOffset)
+	{
+		uint64 end = byteOffset + buffer.Size();
+
+		if (buffer.Size() == 0 || end > volume.GetSize())
+		{
+			volume.ReadSectors (buffer, byteOffset);
+			return;
+		}
+
+		uint64 lastBlock = (end - 1) / BlockSize;
+		uint64 block = byteOffset / BlockSize;
+
+		while (block <= lastBlock)
+		{
+			uint64 blockOffset = block * BlockSize;
+			uint64 copyOffset = max (blockOffset, byteOffset);
+			uint64 copyEnd = min (blockOffset + BlockSize, end);
+
+			if (Get (block, static_cast <size_t> (copyOffset - blockOffset), buffer.GetRange (copyOffset - byteOffset, copyEnd - copyOffset)))
+			{
+				++block;
+				continue;
+			}
+
+			// Consecutive missing blocks are read from the volume in one request
+			uint64 endBlock = block + 1;
+			while (endBlock <= lastBlock && !Contains (endBlock))
+				++endBlock;
+
+			ReadBlocks (volume, block, endBlock, buffer, byteOffset);
+			block = endBlock;
+		}
+	}
+}
@@ -0,0 +1,85 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+#ifndef TC_HEADER_Volume_VolumeSectorCache
+#define TC_HEADER_Volume_VolumeSectorCache
+
+#include "Platform/Platform.h"
+#include "Volume.h"
+
+namespace VeraCrypt
+{
+	// Bounded cache of decrypted volume data held in locked memory. Data is cached in blocks
+	// which are distributed over independently locked shards and evicted using the CLOCK
+	// algorithm. Evicted and invalidated blocks are erased.
+	class VolumeSectorCache
+	{
+	public:
+		VolumeSectorCache (uint64 capacity);
+		virtual ~VolumeSectorCache ();
+
+		void Clear ();
+		uint64 GetHitCount () const;
+		uint64 GetMissCount () const;
+		void Invalidate (uint64 byteOffset, uint64 size);
+		void ReadSectors (Volume &volume, const BufferPtr &buffer, uint64 byteOffset);
+
+		static const size_t BlockSize = 64 * 1024;
+		static const size_t ShardCount = 16;
+
+	protected:
+		struct Slot
+		{
+			Slot () : Block (0), Referenced (false), Size (0), Valid (false) { }
+
+			uint64 Block;
+			bool Referenced;
+			size_t Size;
+			bool Valid;
+		};
+
+		struct Shard
+		{
+			Shard (size_t slotCount);
+			~Shard ();
+
+			void EraseSlot (size_t slot);
+
+			SecureBuffer Data;
+			size_t Hand;
+			uint64 HitCount;
+			map <uint64, size_t> Index;
+			uint64 InvalidationCount;
+			uint64 MissCount;
+			Mutex ShardMutex;
+			vector <Slot> Slots;
+
+		private:
+			Shard (const Shard &);
+			Shard &operator= (const Shard &);
+		};
+
+		bool Contains (uint64 block);
+		bool Get (uint64 block, size_t offset, const BufferPtr &buffer);
+		Shard &GetShard (uint64 block) const { return *Shards[block % ShardCount]; }
+		void Insert (uint64 block, const ConstBufferPtr &data, const uint64 *invalidationCounts);
+		void ReadBlocks (Volume &volume, uint64 firstBlock, uint64 endBlock, const BufferPtr &buffer, uint64 byteOffset);
+
+		vector < shared_ptr <Shard> > Shards;
+
+	private:
+		VolumeSectorCache (const VolumeSectorCache &);
+		VolumeSectorCache &operator= (const VolumeSectorCache &);
+	};
+}
+
+#endif // TC_HEADER_Volume_VolumeSectorCache
@@ -0,0 +1,188 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+
+#include <string.h>
+#include <time.h>
+#include "VolumeStatistics.h"
+#include "Platform/Memory.h"
+#include "Platform/SystemException.h"
+
+namespace VeraCrypt
+{
+	void VolumeStatistics::Add (Operation::Enum operation, uint64 size, uint64 latency)
+	{
+		Entry &entry = Entries[operation][GetSizeClass (size)];
+
+		size_t bucket = 0;
+		while (bucket < LatencyBucketCount - 1 && (latency >> (bucket + 1)) != 0)
+			++bucket;
+
+		__atomic_add_fetch (&entry.ByteCount, size, __ATOMIC_RELAXED);
+		__atomic_add_fetch (&entry.Count, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch (&entry.Latency, latency, __ATOMIC_RELAXED);
+		__atomic_add_fetch (&entry.LatencyBuckets[bucket], 1, __ATOMIC_RELAXED);
+	}
+
+	void VolumeStatistics::Clear ()
+	{
+		Memory::Zero (Entries, sizeof (Entries));
+	}
+
+	void VolumeStatistics::CopyFrom (const VolumeStatistics &other)
+	{
+		const uint64 *source = reinterpret_cast <const uint64 *> (other.Entries);
+		uint64 *destination = reinterpret_cast <uint64 *> (Entries);
+
+		for (size_t i = 0; i < sizeof (Entries) / sizeof (uint64); ++i)
+			destination[i] = Load (source[i]);
+	}
+
+	void VolumeStatistics::Deserialize (const ConstBufferPtr &data)
+	{
+		// Statistics of a different layout are not interpreted
+		if (data.Size() != GetSerializedSize())
+		{
+			Clear();
+			return;
+		}
+
+		uint64 *destination = reinterpret_cast <uint64 *> (Entries);
+		for (size_t i = 0; i < sizeof (Entries) / sizeof (uint64); ++i)
+		{
+			uint64 value;
+			memcpy (&value, data.Get() + i * sizeof (uint64), sizeof (value));
+			destination[i] = Endian::Big (value);
+		}
+	}
+
+	uint64 VolumeStatistics::GetCount (Operation::Enum operation) const
+	{
+		uint64 count = 0;
+		for (int sizeClass = 0; sizeClass < SizeClass::Count; ++sizeClass)
+			count += GetCount (operation, static_cast <SizeClass::Enum> (sizeClass));
+
+		return count;
+	}
+
+	uint64 VolumeStatistics::GetLatency (Operation::Enum operation) const
+	{
+		uint64 latency = 0;
+		for (int sizeClass = 0; sizeClass < SizeClass::Count; ++sizeClass)
+			latency += GetLatency (operation, static_cast <SizeClass::Enum> (sizeClass));
+
+		return latency;
+	}
+
+	uint64 VolumeStatistics::GetLatencyPercentile (Operation::Enum operation, int percent) const
+	{
+		uint64 buckets[LatencyBucketCount];
+		uint64 total = 0;
+
+		for (size_t bucket = 0; bucket < LatencyBucketCount; ++bucket)
+		{
+			buckets[bucket] = 0;
+			for (int sizeClass = 0; sizeClass < SizeClass::Count; ++sizeClass)
+				buckets[bucket] += GetLatencyBucket (operation, static_cast <SizeClass::Enum> (sizeClass), bucket);
+
+			total += buckets[bucket];
+		}
+
+		if (total == 0)
+			return 0;
+
+		// The upper bound of the bucket containing the percentile is returned
+		uint64 count = 0;
+		for (size_t bucket = 0; bucket < LatencyBucketCount; ++bucket)
+		{
+			count += buckets[bucket];
+			if (count * 100 >= total * percent)
+				return (static_cast <uint64> (1) << (bucket + 1)) - 1;
+		}
+
+		return (static_cast <uint64> (1) << LatencyBucketCount) - 1;
+	}
+
+	const char *VolumeStatistics::GetOperationName (Operation::Enum operation)
+	{
+		switch (operation)
+		{
+		case Operation::HostRead:		return "host_read";
+		case Operation::HostWrite:		return "host_write";
+		case Operation::Decrypt:		return "decrypt";
+		case Operation::Encrypt:		return "encrypt";
+		case Operation::ReadRequest:	return "read_request";
+		case Operation::WriteRequest:	return "write_request";
+		default:						throw ParameterIncorrect (SRC_POS);
+		}
+	}
+
+	VolumeStatistics::SizeClass::Enum VolumeStatistics::GetSizeClass (uint64 size)
+	{
+		if (size <= 4 * 1024)
+			return SizeClass::UpTo4KiB;
+
+		if (size <= 64 * 1024)
+			return SizeClass::UpTo64KiB;
+
+		if (size <= 1024 * 1024)
+			return SizeClass::UpTo1MiB;
+
+		return SizeClass::Larger;
+	}
+
+	const char *VolumeStatistics::GetSizeClassName (SizeClass::Enum sizeClass)
+	{
+		switch (sizeClass)
+		{
+		case SizeClass::UpTo4KiB:		return "4k";
+		case SizeClass::UpTo64KiB:		return "64k";
+		case SizeClass::UpTo1MiB:		return "1m";
+		case SizeClass::Larger:			return "large";
+		default:						throw ParameterIncorrect (SRC_POS);
+		}
+	}
+
+	uint64 VolumeStatistics::GetTime ()
+	{
+		struct timespec now;
+		throw_sys_if (clock_gettime (CLOCK_MONOTONIC, &now) == -1);
+
+		return static_cast <uint64> (now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+	}
+
+	bool VolumeStatistics::IsEmpty () const
+	{
+		for (int operation = 0; operation < Operation::Count; ++operation)
+		{
+			for (int sizeClass = 0; sizeClass < SizeClass::Count; ++sizeClass)
+			{
+				if (Load (Entries[operation][sizeClass].Count) != 0)
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	void VolumeStatistics::Serialize (Buffer &data) const
+	{
+		data.Allocate (GetSerializedSize());
+
+		const uint64 *source = reinterpret_cast <const uint64 *> (Entries);
+		for (size_t i = 0; i < sizeof (Entries) / sizeof (uint64); ++i)
+		{
+			uint64 value = Endian::Big (Load (source[i]));
+			memcpy (data.Ptr() + i * sizeof (uint64), &value, sizeof (value));
+		}
+	}
+}
@@ -0,0 +1,94 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+
+#ifndef TC_HEADER_Volume_VolumeStatistics
+#define TC_HEADER_Volume_VolumeStatistics
+
+#include "Platform/Platform.h"
+
+namespace VeraCrypt
+{
+	// Operation counts, transferred bytes and log2-bucketed latency histograms of volume I/O, kept
+	// per operation and size class. Counters are updated atomically by concurrent requests.
+	class VolumeStatistics
+	{
+	public:
+		struct Operation
+		{
+			enum Enum
+			{
+				HostRead,
+				HostWrite,
+				Decrypt,
+				Encrypt,
+				ReadRequest,	// End-to-end read served by the FUSE service
+				WriteRequest,	// End-to-end write served by the FUSE service
+				Count
+			};
+		};
+
+		struct SizeClass
+		{
+			enum Enum
+			{
+				UpTo4KiB,
+				UpTo64KiB,
+				UpTo1MiB,
+				Larger,
+				Count
+			};
+		};
+
+		VolumeStatistics () { Clear(); }
+		VolumeStatistics (const VolumeStatistics &other) { CopyFrom (other); }
+		virtual ~VolumeStatistics () { }
+
+		VolumeStatistics &operator= (const VolumeStatistics &other) { CopyFrom (other); return *this; }
+
+		void Add (Operation::Enum operation, uint64 size, uint64 latency);
+		void Clear ();
+		void Deserialize (const ConstBufferPtr &data);
+		uint64 GetByteCount (Operation::Enum operation, SizeClass::Enum sizeClass) const { return Load (Entries[operation][sizeClass].ByteCount); }
+		uint64 GetCount (Operation::Enum operation) const;
+		uint64 GetCount (Operation::Enum operation, SizeClass::Enum sizeClass) const { return Load (Entries[operation][sizeClass].Count); }
+		uint64 GetLatency (Operation::Enum operation) const;
+		uint64 GetLatency (Operation::Enum operation, SizeClass::Enum sizeClass) const { return Load (Entries[operation][sizeClass].Latency); }
+		uint64 GetLatencyBucket (Operation::Enum operation, SizeClass::Enum sizeClass, size_t bucket) const { return Load (Entries[operation][sizeClass].LatencyBuckets[bucket]); }
+		uint64 GetLatencyPercentile (Operation::Enum operation, int percent) const;
+		static const char *GetOperationName (Operation::Enum operation);
+		static size_t GetSerializedSize () { return sizeof (Entry) * Operation::Count * SizeClass::Count; }
+		static SizeClass::Enum GetSizeClass (uint64 size);
+		static const char *GetSizeClassName (SizeClass::Enum sizeClass);
+		static uint64 GetTime (); // Microseconds
+		bool IsEmpty () const;
+		void Serialize (Buffer &data) const;
+
+		static const size_t LatencyBucketCount = 32; // Bucket N counts latencies of 2^N to 2^(N+1)-1 microseconds; bucket 0 includes 0
+
+	protected:
+		struct Entry
+		{
+			uint64 ByteCount;
+			uint64 Count;
+			uint64 Latency;
+			uint64 LatencyBuckets[LatencyBucketCount];
+		};
+
+		void CopyFrom (const VolumeStatistics &other);
+		static uint64 Load (const uint64 &counter) { return __atomic_load_n (&counter, __ATOMIC_RELAXED); }
+
+		Entry Entries[Operation::Count][SizeClass::Count];
+	};
+}
+
+#endif // TC_HEADER_Volume_VolumeStatistics
@@ -0,0 +1,300 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+#include <algorithm>
+#include "VolumeWriteBack.h"
+
+namespace VeraCrypt
+{
+	namespace
+	{
+		bool PendingWriteOffsetLess (const shared_ptr <VolumeWriteBack::PendingWrite> &first, const shared_ptr <VolumeWriteBack::PendingWrite> &second)
+		{
+			return first->Offset < second->Offset;
+		}
+	}
+
+	VolumeWriteBack::PendingWrite::PendingWrite (const ConstBufferPtr &data, uint64 byteOffset)
+		: Data (data.Size()), Offset (byteOffset)
+	{
+		Data.CopyFrom (data);
+	}
+
+	VolumeWriteBack::VolumeWriteBack (Volume &volume, uint64 capacity)
+		: Capacity (capacity), InFlightSize (0), QueuedSize (0), StopPending (false), TargetVolume (volume), WriteCount (0), WrittenCount (0)
+	{
+		WriteBackThread.reset (new Thread);
+		WriteBackThread->Start (new ThreadFunctor (this));
+	}
+
+	VolumeWriteBack::~VolumeWriteBack ()
+	{
+		try
+		{
+			Stop();
+		}
+		catch (...) { }
+	}
+
+	void VolumeWriteBack::ApplyPendingWrites (const PendingWriteList &writes, const BufferPtr &buffer, uint64 byteOffset)
+	{
+		uint64 end = byteOffset + buffer.Size();
+
+		foreach (shared_ptr <PendingWrite> write, writes)
+		{
+			uint64 writeEnd = write->Offset + write->Data.Size();
+			uint64 copyOffset = max (write->Offset, byteOffset);
+			uint64 copyEnd = min (writeEnd, end);
+
+			if (copyOffset < copyEnd)
+			{
+				buffer.GetRange (static_cast <size_t> (copyOffset - byteOffset), static_cast <size_t> (copyEnd - copyOffset))
+					.CopyFrom (write->Data.GetRange (static_cast <size_t> (copyOffset - write->Offset), static_cast <size_t> (copyEnd - copyOffset)));
+			}
+		}
+	}
+
+	void VolumeWriteBack::CheckWriteError ()
+	{
+		if (WriteError.get())
+		{
+			auto_ptr <Exception> error = WriteError;
+			error->Throw();
+		}
+	}
+
+	void VolumeWriteBack::Flush (bool flushHostFile)
+	{
+		uint64 writeNumber;
+		{
+			ScopeLock lock (PendingWritesMutex);
+			writeNumber = WriteCount;
+		}
+
+		WriteQueuedEvent.Signal();
+		WaitForCompletion (writeNumber);
+
+		{
+			ScopeLock lock (PendingWritesMutex);
+			CheckWriteError();
+		}
+
+		if (flushHostFile)
+			TargetVolume.GetFile()->Flush();
+	}
+
+	void VolumeWriteBack::GetPendingWrites (uint64 byteOffset, uint64 size, PendingWriteList &writes)
+	{
+		ScopeLock lock (PendingWritesMutex);
+
+		// Writes in flight were submitted before the queued ones and must be applied first
+		foreach (shared_ptr <PendingWrite> write, InFlightWrites)
+		{
+			if (write->Offset < byteOffset + size && write->Offset + write->Data.Size() > byteOffset)
+				writes.push_back (write);
+		}
+
+		foreach (shared_ptr <PendingWrite> write, QueuedWrites)
+		{
+			if (write->Offset < byteOffset + size && write->Offset + write->Data.Size() > byteOffset)
+				writes.push_back (write);
+		}
+	}
+
+	void VolumeWriteBack::SetWriteError ()
+	{
+		ScopeLock lock (PendingWritesMutex);
+
+		try
+		{
+			throw;
+		}
+		catch (Exception &e)
+		{
+			if (!WriteError.get())
+				WriteError.reset (e.CloneNew());
+		}
+		catch (exception &e)
+		{
+			if (!WriteError.get())
+				WriteError.reset (new ExternalException (SRC_POS, StringConverter::ToExceptionString (e)));
+		}
+		catch (...)
+		{
+			if (!WriteError.get())
+				WriteError.reset (new UnknownException (SRC_POS));
+		}
+	}
+
+	void VolumeWriteBack::SignalCompletionWaiters ()
+	{
+		foreach (SyncEvent *waiter, CompletionWaiters)
+			waiter->Signal();
+
+		CompletionWaiters.clear();
+	}
+
+	void VolumeWriteBack::Stop ()
+	{
+		if (!WriteBackThread)
+			return;
+
+		{
+			ScopeLock lock (PendingWritesMutex);
+			StopPending = true;
+		}
+
+		// Queued data is written before the thread exits
+		WriteQueuedEvent.Signal();
+		WriteBackThread->Join();
+		WriteBackThread.reset();
+	}
+
+	void VolumeWriteBack::WaitForCompletion (uint64 writeNumber)
+	{
+		while (true)
+		{
+			SyncEvent completedEvent;
+			{
+				ScopeLock lock (PendingWritesMutex);
+
+				if (WrittenCount >= writeNumber || !WriteBackThread)
+					return;
+
+				CompletionWaiters.push_back (&completedEvent);
+			}
+
+			completedEvent.Wait();
+		}
+	}
+
+	void VolumeWriteBack::Write (const ConstBufferPtr &buffer, uint64 byteOffset)
+	{
+		TargetVolume.CheckWriteRange (byteOffset, buffer.Size());
+
+		shared_ptr <PendingWrite> write (new PendingWrite (buffer, byteOffset));
+
+		while (true)
+		{
+			uint64 writeNumber;
+			{
+				ScopeLock lock (PendingWritesMutex);
+				CheckWriteError();
+
+				if (StopPending)
+					throw NotInitialized (SRC_POS);
+
+				if (QueuedSize + InFlightSize + buffer.Size() <= Capacity || QueuedSize + InFlightSize == 0)
+				{
+					QueuedWrites.push_back (write);
+					QueuedSize += buffer.Size();
+					++WriteCount;
+
+					// Writes submitted while the thread writes the previous batch form the next batch
+					WriteQueuedEvent.Signal();
+					return;
+				}
+
+				writeNumber = WriteCount;
+			}
+
+			// Buffer is full
+			WriteQueuedEvent.Signal();
+			WaitForCompletion (writeNumber);
+		}
+	}
+
+	void VolumeWriteBack::WriteBackThreadProc ()
+	{
+		while (true)
+		{
+			WriteQueuedEvent.Wait();
+
+			while (true)
+			{
+				uint64 writeNumber;
+				{
+					ScopeLock lock (PendingWritesMutex);
+
+					if (QueuedWrites.empty())
+					{
+						SignalCompletionWaiters();
+
+						if (StopPending)
+							return;
+
+						break;
+					}
+
+					InFlightWrites.swap (QueuedWrites);
+					InFlightSize = QueuedSize;
+					QueuedSize = 0;
+					writeNumber = WriteCount;
+				}
+
+				WritePendingData (InFlightWrites);
+
+				ScopeLock lock (PendingWritesMutex);
+				InFlightWrites.clear();
+				InFlightSize = 0;
+				WrittenCount = writeNumber;
+				SignalCompletionWaiters();
+			}
+		}
+	}
+
+	void VolumeWriteBack::WritePendingData (const PendingWriteList &writes)
+	{
+		vector < shared_ptr <PendingWrite> > sortedWrites (writes.begin(), writes.end());
+		stable_sort (sortedWrites.begin(), sortedWrites.end(), PendingWriteOffsetLess);
+
+		size_t runStart = 0;
+		while (runStart < sortedWrites.size())
+		{
+			uint64 runOffset = sortedWrites[runStart]->Offset;
+			uint64 runEnd = runOffset + sortedWrites[runStart]->Data.Size();
+
+			// Overlapping writes must be merged; adjacent writes are merged up to the maximum write size
+			size_t next = runStart + 1;
+			while (next < sortedWrites.size()
+				&& (sortedWrites[next]->Offset < runEnd
+				|| (sortedWrites[next]->Offset == runEnd && runEnd + sortedWrites[next]->Data.Size() - runOffset <= MaxWriteSize)))
+			{
+				runEnd = max (runEnd, sortedWrites[next]->Offset + sortedWrites[next]->Data.Size());
+				++next;
+			}
+
+			SecureBuffer runBuffer (static_cast <size_t> (runEnd - runOffset), Volume::DirectIoAlignment);
+
+			// Writes are applied in the order of submission
+			foreach (shared_ptr <PendingWrite> write, writes)
+			{
+				if (write->Offset >= runOffset && write->Offset < runEnd)
+					runBuffer.GetRange (static_cast <size_t> (write->Offset - runOffset), write->Data.Size()).CopyFrom (write->Data);
+			}
+
+			try
+			{
+				TargetVolume.WriteSectorsInPlace (runBuffer, runOffset);
+			}
+			catch (...)
+			{
+				SetWriteError();
+			}
+
+			VolumeSectorsWrittenEventArgs args (runOffset, runEnd - runOffset);
+			SectorsWrittenEvent.Raise (args);
+
+			runStart = next;
+		}
+	}
+}
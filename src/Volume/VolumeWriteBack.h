@@ -0,0 +1,102 @@
+/*
+ Derived from source code of TrueCrypt 7.1a, which is
+ Copyright (c) 2008-2012 TrueCrypt Developers Association and which is governed
+ by the TrueCrypt License 3.0.
+
+ Modifications and additions to the original source code (contained in this file)
+ and all other portions of this file are Copyright (c) 2013-2017 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages.
+*/
+
+#ifndef TC_HEADER_Volume_VolumeWriteBack
+#define TC_HEADER_Volume_VolumeWriteBack
+
+#include "Platform/Platform.h"
+#include "Platform/SyncEvent.h"
+#include "Platform/Thread.h"
+#include "Volume.h"
+
+namespace VeraCrypt
+{
+	struct VolumeSectorsWrittenEventArgs : public EventArgs
+	{
+		VolumeSectorsWrittenEventArgs (uint64 byteOffset, uint64 size) : ByteOffset (byteOffset), Size (size) { }
+
+		uint64 ByteOffset;
+		uint64 Size;
+	};
+
+	// Buffers volume writes and writes them on a background thread. Buffered writes
+	// are sorted, and adjacent and overlapping writes are merged into single encrypted write requests.
+	// Writes are checked against the volume protection when they are submitted. Errors of background
+	// writes are reported by the next call to Write() or Flush().
+	class VolumeWriteBack
+	{
+	public:
+		struct PendingWrite
+		{
+			PendingWrite (const ConstBufferPtr &data, uint64 byteOffset);
+
+			SecureBuffer Data;
+			uint64 Offset;
+
+		private:
+			PendingWrite (const PendingWrite &);
+			PendingWrite &operator= (const PendingWrite &);
+		};
+
+		typedef list < shared_ptr <PendingWrite> > PendingWriteList;
+
+		VolumeWriteBack (Volume &volume, uint64 capacity);
+		virtual ~VolumeWriteBack ();
+
+		static void ApplyPendingWrites (const PendingWriteList &writes, const BufferPtr &buffer, uint64 byteOffset);
+		void Flush (bool flushHostFile);
+		void GetPendingWrites (uint64 byteOffset, uint64 size, PendingWriteList &writes);
+		void Stop ();
+		void Write (const ConstBufferPtr &buffer, uint64 byteOffset);
+
+		Event SectorsWrittenEvent; // Raised on the background thread after data has been written to the volume
+
+		static const size_t MaxWriteSize = 4 * 1024 * 1024;
+
+	protected:
+		struct ThreadFunctor : public Functor
+		{
+			ThreadFunctor (VolumeWriteBack *writeBack) : WriteBack (writeBack) { }
+			virtual void operator() () { WriteBack->WriteBackThreadProc(); }
+
+			VolumeWriteBack *WriteBack;
+		};
+
+		void CheckWriteError ();
+		void SetWriteError (); // Stores the exception being handled
+		void SignalCompletionWaiters ();
+		void WaitForCompletion (uint64 writeNumber);
+		void WriteBackThreadProc ();
+		void WritePendingData (const PendingWriteList &writes);
+
+		uint64 Capacity;
+		list <SyncEvent *> CompletionWaiters;
+		PendingWriteList InFlightWrites;
+		uint64 InFlightSize;
+		Mutex PendingWritesMutex;
+		PendingWriteList QueuedWrites;
+		uint64 QueuedSize;
+		bool StopPending;
+		Volume &TargetVolume;
+		uint64 WriteCount;
+		uint64 WrittenCount;
+		auto_ptr <Exception> WriteError;
+		shared_ptr <Thread> WriteBackThread;
+		SyncEvent WriteQueuedEvent;
+
+	private:
+		VolumeWriteBack (const VolumeWriteBack &);
+		VolumeWriteBack &operator= (const VolumeWriteBack &);
+	};
+}
+
+#endif // TC_HEADER_Volume_VolumeWriteBack